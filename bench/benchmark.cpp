@@ -0,0 +1,444 @@
+// MIT License
+//
+// Copyright (c) 2021-2022 char-lie
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <new>
+#include <opencv2/core.hpp>
+#include <opencv2/core/mat.hpp>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "average_intensity_calculator.hpp"
+#include "circular_buffer.hpp"
+#include "frame.hpp"
+#include "frame_pool.hpp"
+#include "frame_queue.hpp"
+#include "frame_source.hpp"
+#include "frame_transform.hpp"
+#include "intensity_window.hpp"
+
+namespace {
+
+std::atomic<std::size_t> heap_allocations{0U};
+
+// Counts buffers of `cv::Mat`, which do not go through `operator new`
+class CountingMatAllocator : public cv::MatAllocator {
+  const cv::MatAllocator* allocator{cv::Mat::getStdAllocator()};
+
+ public:
+  mutable std::atomic<std::size_t> allocations{0U};
+
+  cv::UMatData* allocate(int dims, const int* sizes, int type, void* data,
+                         size_t* step, cv::AccessFlag flags,
+                         cv::UMatUsageFlags usage_flags) const override {
+    if (data == nullptr) {
+      this->allocations.fetch_add(1U, std::memory_order_relaxed);
+    }
+    return this->allocator->allocate(dims, sizes, type, data, step, flags,
+                                     usage_flags);
+  }
+
+  bool allocate(cv::UMatData* data, cv::AccessFlag flags,
+                cv::UMatUsageFlags usage_flags) const override {
+    return this->allocator->allocate(data, flags, usage_flags);
+  }
+
+  void deallocate(cv::UMatData* data) const override {
+    this->allocator->deallocate(data);
+  }
+};
+
+CountingMatAllocator mat_allocator{};
+FramePool frame_pool{};
+
+struct Resolution {
+  std::string name;
+  cv::Size size;
+};
+
+struct Result {
+  std::string name;
+  std::size_t iterations{0U};
+  double ns_per_frame{0.0};
+  double mpix_per_second{0.0};
+  double allocations_per_frame{0.0};
+};
+
+struct Settings {
+  std::chrono::duration<double> min_time{1.0};
+  std::optional<std::string> json_path{};
+  std::string filter{};
+};
+
+std::size_t allocations() {
+  return heap_allocations.load(std::memory_order_relaxed) +
+         mat_allocator.allocations.load(std::memory_order_relaxed) +
+         frame_pool.stats().misses;
+}
+
+void print(const Result& result) {
+  static constexpr int name_width{36};
+  static constexpr int time_width{14};
+  static constexpr int rate_width{10};
+  static constexpr int allocations_width{8};
+  std::cout << std::left << std::setw(name_width) << result.name << std::right
+            << std::fixed << std::setprecision(1) << std::setw(time_width)
+            << result.ns_per_frame << " ns/frame" << std::setw(rate_width)
+            << result.mpix_per_second << " MPix/s"
+            << std::setw(allocations_width) << std::setprecision(2)
+            << result.allocations_per_frame << " allocs/frame" << std::endl;
+}
+
+// Calls `frame` until both `min_time` and `min_iterations` are reached.
+// Every call processes `frames_per_call` frames.
+template <typename F>
+requires std::invocable<F> void measure(
+    const std::string& name, const cv::Size resolution,
+    const Settings& settings, std::vector<Result>& results, F frame,
+    const std::size_t frames_per_call = 1U) {
+  if (name.find(settings.filter) == std::string::npos) {
+    return;
+  }
+
+  static constexpr std::size_t warm_up_iterations{3U};
+  static constexpr std::size_t min_iterations{10U};
+  static constexpr double nanoseconds_in_second{1e9};
+  static constexpr double pixels_in_megapixel{1e6};
+
+  for (std::size_t i{0U}; i < warm_up_iterations; ++i) {
+    frame();
+  }
+
+  Result result{name};
+  const std::size_t allocations_before{allocations()};
+  const auto start_time{std::chrono::steady_clock::now()};
+  std::chrono::duration<double> elapsed{0.0};
+  while (elapsed < settings.min_time or result.iterations < min_iterations) {
+    frame();
+    ++result.iterations;
+    elapsed = std::chrono::steady_clock::now() - start_time;
+  }
+
+  const auto iterations{static_cast<double>(result.iterations) *
+                        static_cast<double>(frames_per_call)};
+  result.ns_per_frame = elapsed.count() * nanoseconds_in_second / iterations;
+  result.mpix_per_second = static_cast<double>(resolution.area()) *
+                           iterations / elapsed.count() / pixels_in_megapixel;
+  result.allocations_per_frame =
+      static_cast<double>(allocations() - allocations_before) / iterations;
+  print(result);
+  results.push_back(std::move(result));
+}
+
+cv::Mat make_frame(const cv::Size resolution) {
+  SyntheticFrameSource source{resolution, 0.0, SyntheticPattern::gradient};
+  cv::Mat frame;
+  source.read(frame);
+  return frame;
+}
+
+void benchmark_intensity(const Resolution& resolution,
+                         const Settings& settings,
+                         std::vector<Result>& results) {
+  using Method = AverageIntensityCalculator::Method;
+  const cv::Mat frame{make_frame(resolution.size)};
+  const std::vector<std::pair<std::string, Method>> methods{
+      {"fused", Method::fused},
+      {"fused_scalar", Method::fused_scalar},
+      {"exact", Method::exact},
+      {"histogram", Method::histogram},
+      {"sampled", Method::sampled},
+  };
+  float sink{0.0F};
+  for (const auto& [method_name, method] : methods) {
+    AverageIntensityCalculator calculator{method};
+    measure("intensity/" + method_name + "/" + resolution.name,
+            resolution.size, settings, results,
+            [&calculator, &frame, &sink]() {
+              calculator.replace_image(frame);
+              sink += calculator.average();
+            });
+  }
+
+  AverageIntensityCalculator banded_calculator{
+      Method::fused, {}, cv::getNumThreads()};
+  measure("intensity/fused_bands/" + resolution.name, resolution.size,
+          settings, results, [&banded_calculator, &frame, &sink]() {
+            banded_calculator.replace_image(frame);
+            sink += banded_calculator.average();
+          });
+
+  // Frames of several streams at once
+  static constexpr std::size_t batch_size{8U};
+  const std::vector<cv::Mat> batch(batch_size, frame);
+  std::vector<float> averages(batch_size);
+  AverageIntensityCalculator batch_calculator{Method::fused};
+  measure(
+      "intensity/batch/" + resolution.name, resolution.size, settings,
+      results,
+      [&batch_calculator, &batch, &averages, &sink]() {
+        batch_calculator.average_batch(batch, averages);
+        sink += averages.front();
+      },
+      batch_size);
+
+  // Steady state: every frame evicts the oldest one
+  static constexpr std::size_t window_length{10U};
+  IntensityWindow window{window_length};
+  measure("intensity/window/" + resolution.name, resolution.size, settings,
+          results, [&window, &frame, &sink]() {
+            window.add(frame);
+            sink += static_cast<float>(window.statistics().mean);
+          });
+  if (sink < 0.0F) {
+    std::cerr << "Negative intensity" << std::endl;
+  }
+}
+
+void benchmark_gray_rotate(const Resolution& resolution,
+                           const Settings& settings,
+                           std::vector<Result>& results) {
+  const cv::Mat frame{make_frame(resolution.size)};
+  const std::vector<std::pair<std::string, std::optional<cv::RotateFlags>>>
+      phases{
+          {"0", std::nullopt},
+          {"90cw", cv::ROTATE_90_CLOCKWISE},
+          {"180", cv::ROTATE_180},
+          {"90ccw", cv::ROTATE_90_COUNTERCLOCKWISE},
+      };
+  for (const auto& [phase_name, rotation] : phases) {
+    // Like `queue_thread`, which hands every result over to the display
+    measure("gray_rotate/" + phase_name + "/" + resolution.name,
+            resolution.size, settings, results,
+            [&frame, rotation = rotation]() {
+              cv::Mat result;
+              result.allocator = &frame_pool;
+              gray_rotate(frame, result, rotation);
+            });
+  }
+
+  // Latency of one frame split across the OpenCV threads
+  const int bands{cv::getNumThreads()};
+  measure("gray_rotate/90cw_bands/" + resolution.name, resolution.size,
+          settings, results, [&frame, bands]() {
+            cv::Mat result;
+            result.allocator = &frame_pool;
+            gray_rotate(frame, result, cv::ROTATE_90_CLOCKWISE, bands);
+          });
+}
+
+void benchmark_flip(const Resolution& resolution, const Settings& settings,
+                    std::vector<Result>& results) {
+  const cv::Mat frame{make_frame(resolution.size)};
+  cv::Mat flipped;
+  // `mirror` does not allocate
+  flipped.create(frame.size(), frame.type());
+  measure("flip/" + resolution.name, resolution.size, settings, results,
+          [&frame, &flipped]() { cv::flip(frame, flipped, 1); });
+  measure("flip/bands/" + resolution.name, resolution.size, settings, results,
+          [&frame, &flipped, bands = cv::getNumThreads()]() {
+            mirror(frame, flipped, bands);
+          });
+}
+
+// What a change-gated stage pays for a frame it skips
+void benchmark_signature(const Resolution& resolution,
+                         const Settings& settings,
+                         std::vector<Result>& results) {
+  const cv::Mat frame{make_frame(resolution.size)};
+  cv::Mat signature;
+  measure("signature/" + resolution.name, resolution.size, settings, results,
+          [&frame, &signature]() { frame_signature(frame, signature); });
+}
+
+// The producer pushes frames while the consumer keeps copying the latest one
+// out, so the result is the capture-side cost of a push under contention
+template <typename Buffer, typename P, typename C>
+void benchmark_buffer(const std::string& name, const Resolution& resolution,
+                      const Settings& settings, std::vector<Result>& results,
+                      Buffer& buffer, P push, C consume) {
+  if ((name + "/" + resolution.name).find(settings.filter) ==
+      std::string::npos) {
+    return;
+  }
+  const cv::Mat frame{make_frame(resolution.size)};
+  push(buffer, frame);
+
+  std::atomic<bool> is_finished{false};
+  std::thread consumer{[&buffer, &is_finished, &consume]() {
+    cv::Mat copy;
+    while (!is_finished.load(std::memory_order_relaxed)) {
+      consume(buffer, copy);
+    }
+  }};
+  measure(name + "/" + resolution.name, resolution.size, settings, results,
+          [&buffer, &frame, &push]() { push(buffer, frame); });
+  is_finished.store(true, std::memory_order_relaxed);
+  consumer.join();
+}
+
+void benchmark_buffers(const Resolution& resolution, const Settings& settings,
+                       std::vector<Result>& results) {
+  static constexpr std::size_t buffer_size{10U};
+  using Locked = CircularBuffer<cv::Mat, buffer_size>;
+
+  Locked circular_buffer{};
+  benchmark_buffer(
+      "circular_buffer", resolution, settings, results, circular_buffer,
+      [](Locked& buffer, const cv::Mat& frame) { buffer.push(frame); },
+      [](Locked& buffer, cv::Mat& copy) {
+        const std::unique_lock lock{buffer.lock()};
+        buffer.last().copyTo(copy);
+      });
+  // The handover between pipeline stages that replaced the ring
+  FrameQueue frame_queue{1U, QueuePolicy::latest_only};
+  benchmark_buffer(
+      "frame_queue", resolution, settings, results, frame_queue,
+      [](FrameQueue& queue, const cv::Mat& frame) {
+        queue.push(Frame{.image = frame});
+      },
+      [](FrameQueue& queue, cv::Mat& copy) {
+        if (const auto entry{queue.try_pop()}) {
+          entry->frame.image.copyTo(copy);
+        }
+      });
+}
+
+Settings parse_settings(int argc, char* argv[]) {
+  const std::span<char*> arguments{argv, static_cast<std::size_t>(argc)};
+  if (arguments.size() % 2U != 1U) {
+    throw std::runtime_error{
+        "Usage: benchmark [--min-time SECONDS] [--json PATH] "
+        "[--filter SUBSTRING]"};
+  }
+
+  Settings settings{};
+  for (std::size_t i{1U}; i < arguments.size(); i += 2U) {
+    const std::string name{arguments[i]};
+    const std::string value{arguments[i + 1U]};
+    if (name == "--min-time") {
+      settings.min_time = std::chrono::duration<double>{std::stod(value)};
+    } else if (name == "--json") {
+      settings.json_path = value;
+    } else if (name == "--filter") {
+      settings.filter = value;
+    } else {
+      throw std::runtime_error{"Unknown option `" + name + "`"};
+    }
+  }
+  return settings;
+}
+
+void write_json(const std::string& path, const std::vector<Result>& results) {
+  std::ofstream file{path};
+  if (!file) {
+    throw std::runtime_error{"Cannot open `" + path + "` for writing"};
+  }
+  file << std::setprecision(std::numeric_limits<double>::max_digits10)
+       << "{\n  \"opencv_version\": \"" << CV_VERSION << "\",\n"
+       << "  \"results\": [";
+  for (std::size_t i{0U}; i < results.size(); ++i) {
+    const Result& result{results[i]};
+    file << (i == 0U ? "" : ",") << "\n    {\"name\": \"" << result.name
+         << "\", \"iterations\": " << result.iterations
+         << ", \"ns_per_frame\": " << result.ns_per_frame
+         << ", \"mpix_per_second\": " << result.mpix_per_second
+         << ", \"allocations_per_frame\": " << result.allocations_per_frame
+         << "}";
+  }
+  file << "\n  ]\n}\n";
+}
+
+}  // namespace
+
+// Allocations are counted for the whole process.
+// NOLINTNEXTLINE(cert-dcl58-cpp)
+void* operator new(std::size_t size) {
+  heap_allocations.fetch_add(1U, std::memory_order_relaxed);
+  // NOLINTNEXTLINE(cppcoreguidelines-no-malloc,hicpp-no-malloc)
+  if (void* pointer{std::malloc(size == 0U ? 1U : size)}; pointer != nullptr) {
+    return pointer;
+  }
+  throw std::bad_alloc{};
+}
+
+// NOLINTNEXTLINE(cert-dcl58-cpp)
+void operator delete(void* pointer) noexcept {
+  // NOLINTNEXTLINE(cppcoreguidelines-no-malloc,hicpp-no-malloc)
+  std::free(pointer);
+}
+
+// NOLINTNEXTLINE(cert-dcl58-cpp)
+void operator delete(void* pointer, std::size_t /*size*/) noexcept {
+  // NOLINTNEXTLINE(cppcoreguidelines-no-malloc,hicpp-no-malloc)
+  std::free(pointer);
+}
+
+int main(int argc, char* argv[]) try {
+  const Settings settings{parse_settings(argc, argv)};
+  cv::Mat::setDefaultAllocator(&mat_allocator);
+
+  const std::vector<Resolution> resolutions{
+      {"720p", {1280, 720}},
+      {"1080p", {1920, 1080}},
+      {"4k", {3840, 2160}},
+  };
+  using Benchmark = void (*)(const Resolution&, const Settings&,
+                             std::vector<Result>&);
+  const std::vector<Benchmark> benchmarks{
+      benchmark_intensity,
+      benchmark_gray_rotate,
+      benchmark_flip,
+      benchmark_signature,
+      benchmark_buffers,
+  };
+
+  std::vector<Result> results{};
+  for (const auto& benchmark : benchmarks) {
+    for (const auto& resolution : resolutions) {
+      benchmark(resolution, settings, results);
+    }
+  }
+
+  if (settings.json_path) {
+    write_json(*settings.json_path, results);
+  }
+
+  cv::Mat::setDefaultAllocator(nullptr);
+  return EXIT_SUCCESS;
+} catch (std::exception& exception) {
+  std::cerr << "Unhandled exception: '" << exception.what() << "'" << std::endl;
+  return EXIT_FAILURE;
+} catch (...) {
+  std::cerr << "Unexpected exception" << std::endl;
+  return EXIT_FAILURE;
+}
@@ -0,0 +1,115 @@
+// MIT License
+//
+// Copyright (c) 2021-2022 char-lie
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Prints the latency and mean of the frames a `--sink shm:PREFIX` run
+// publishes, reading them in place from shared memory:
+// `shared_frame_reader /PREFIX.Thread_1 [FRAMES]`
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <opencv2/core.hpp>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "shared_frame_ring.hpp"
+
+namespace {
+
+constexpr std::chrono::milliseconds idle_period{1};
+
+// Opens the ring replacing a closed one, if any appears shortly
+bool reopen(std::optional<SharedFrameRingReader>& reader,
+            const std::string& name) {
+  constexpr int attempts{100};
+  reader.reset();
+  for (int attempt{0}; attempt < attempts; ++attempt) {
+    try {
+      reader.emplace(name);
+      return true;
+    } catch (std::runtime_error&) {
+      std::this_thread::sleep_for(idle_period);
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) try {
+  if (argc < 2 or argc > 3) {
+    std::cerr << "Usage: shared_frame_reader SEGMENT [FRAMES]\n";
+    return EXIT_FAILURE;
+  }
+  const std::string name{argv[1]};
+  std::optional<SharedFrameRingReader> reader{};
+  reader.emplace(name);
+  const std::uint64_t frame_limit{argc == 3 ? std::stoull(argv[2]) : 100U};
+
+  std::uint64_t last_sequence{0U};
+  std::uint64_t read_count{0U};
+  std::uint64_t missed_count{0U};
+  while (read_count < frame_limit) {
+    const std::optional<SharedFrameRingReader::View> view{
+        reader->latest(last_sequence)};
+    if (!view) {
+      if (reader->is_closed()) {
+        // Replaced with larger slots, or the run is over
+        if (!reopen(reader, name)) {
+          break;
+        }
+        last_sequence = 0U;
+        continue;
+      }
+      std::this_thread::sleep_for(idle_period);
+      continue;
+    }
+    const auto latency{std::chrono::steady_clock::now() - view->capture_time};
+    const cv::Scalar mean{cv::mean(view->image)};
+    if (!reader->is_intact(*view)) {
+      // Too slow: the writer has lapped the ring while the frame was read
+      continue;
+    }
+    if (last_sequence != 0U) {
+      missed_count += view->sequence - last_sequence - 1U;
+    }
+    last_sequence = view->sequence;
+    ++read_count;
+    std::cout << "Frame " << view->sequence << ": " << view->image.cols << "x"
+              << view->image.rows << ", mean " << mean[0] << ", latency "
+              << std::chrono::duration<double, std::milli>(latency).count()
+              << " ms\n";
+  }
+  std::cout << "Read " << read_count << " frames, missed " << missed_count
+            << '\n';
+  return EXIT_SUCCESS;
+} catch (std::exception& exception) {
+  std::cerr << "Unhandled exception: '" << exception.what() << "'" << std::endl;
+  return EXIT_FAILURE;
+} catch (...) {
+  std::cerr << "Unexpected exception" << std::endl;
+  return EXIT_FAILURE;
+}
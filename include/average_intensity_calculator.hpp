@@ -23,17 +23,67 @@
 #ifndef AVERAGE_INTENSITY_CALCULATOR_HPP
 #define AVERAGE_INTENSITY_CALCULATOR_HPP
 
+#include <cstddef>
+#include <span>
 #include <vector>
 
 #include "opencv2/core/mat.hpp"
 
+struct IntensitySampling {
+  // 8 reads 1/64 of the pixels
+  int stride{8};
+  // Half-width of the confidence interval in standard errors
+  float confidence_sigmas{3.0F};
+};
+
 class AverageIntensityCalculator {
+ public:
+  enum class Method {
+    // One vectorized pass over the 3-channel frame with integer per-channel
+    // sums, weighted at the end
+    fused,
+    // The same pass without SIMD
+    fused_scalar,
+    // Rounds every pixel like `cv::cvtColor` does: the result is the exact
+    // mean of the grayscale image, i.e. what `histogram` computes
+    exact,
+    // Grayscale copy of the frame and its histogram
+    histogram,
+    // Every `stride`-th pixel of every `stride`-th row,
+    // see `IntensitySampling` and `exceeds`
+    sampled,
+  };
+
+  struct Estimate {
+    float average{0.0F};
+    // The true average is within `average ± margin` with high confidence,
+    // 0 for the full methods
+    float margin{0.0F};
+  };
+
  private:
+  Method method;
+  IntensitySampling sampling;
+  int bands;
+  std::size_t escalation_count{0U};
+  cv::Mat frame{};
+  // Grayscale frame and its histogram of the histogram method
+  cv::Mat gray_frame{};
   cv::Mat histogram{};
-  std::vector<cv::Mat> images{cv::Mat{}};
+  // The same per image of a batch, apart from the frame above
+  std::vector<cv::Mat> batch_images{};
+  std::vector<cv::Mat> batch_histograms{};
+
+  // Uses the scratch buffers at `scratch_index` for the histogram
+  float batch_average(const cv::Mat& image, std::size_t scratch_index);
 
  public:
-  AverageIntensityCalculator() = default;
+  // The fused methods sum `parallel_bands` bands of rows of a frame
+  // in parallel on the OpenCV threads
+  explicit AverageIntensityCalculator(
+      Method calculation_method = Method::fused,
+      IntensitySampling sampling_settings = IntensitySampling{},
+      int parallel_bands = 1);
   AverageIntensityCalculator(const AverageIntensityCalculator&) = delete;
   AverageIntensityCalculator(AverageIntensityCalculator&&) noexcept = default;
   AverageIntensityCalculator& operator=(const AverageIntensityCalculator&) =
@@ -43,6 +93,18 @@ class AverageIntensityCalculator {
 
   void replace_image(const cv::Mat& image);
   float average();
+  // Averages of all `batch` images computed in parallel across the images,
+  // the same as `replace_image` and `average` for each of them.
+  // Only 3-channel images with [0; 255] intensity range are allowed.
+  // Scratch buffers are kept for the next batch of the same size.
+  void average_batch(std::span<const cv::Mat> batch, std::span<float> averages);
+  Estimate estimate();
+  // Whether the average is above the `limit`.
+  // A sampled estimate whose confidence interval contains the `limit` is
+  // escalated to the full computation.
+  bool exceeds(float limit);
+  // Sampled estimates that were too close to the limit
+  [[nodiscard]] std::size_t escalations() const noexcept;
 
   ~AverageIntensityCalculator() = default;
 };
@@ -0,0 +1,95 @@
+// MIT License
+//
+// Copyright (c) 2021-2022 char-lie
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef CAPTURE_THREAD_HPP
+#define CAPTURE_THREAD_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <thread>
+
+#include "frame_pool.hpp"
+#include "frame_source.hpp"
+#include "metrics.hpp"
+#include "pipeline.hpp"
+#include "thread_settings.hpp"
+
+// Grabs frames on a dedicated thread and pushes them to the `stream` of the
+// pipeline, so neither processing nor display delays the next grab.
+// Requests a stop when the source or the limits are exhausted.
+// With `metrics` it reports read durations named after the `stream`.
+class CaptureThread {
+ public:
+  struct Settings {
+    std::optional<std::size_t> frame_limit{};
+    std::optional<std::chrono::duration<double>> duration_limit{};
+    // Buffers of the first frame geometry allocated upfront,
+    // none for compressed sources
+    std::size_t preallocated_frames{8U};
+    // The buffers are allocated by the capture thread,
+    // so its CPUs choose their NUMA node
+    ThreadSettings thread_settings{};
+  };
+
+ private:
+  FrameSource& source;
+  Pipeline& pipeline;
+  std::string stream;
+  FramePool& frame_pool;
+  Settings settings;
+  std::stop_source stop_source;
+  LatencyHistogram* read_time{nullptr};
+  // Written by the capture thread, read after `join`
+  std::uint64_t frame_count{0U};
+  std::chrono::steady_clock::time_point start_time{};
+  std::chrono::steady_clock::time_point end_time{};
+  std::exception_ptr error{};
+  std::thread thread{};
+
+  [[nodiscard]] bool is_over() const;
+  void run();
+
+ public:
+  CaptureThread(FrameSource& frame_source, Pipeline& frame_pipeline,
+                std::string stream_name, FramePool& pool,
+                Settings capture_settings, std::stop_source shared_stop_source,
+                Metrics* metrics = nullptr);
+  CaptureThread(const CaptureThread&) = delete;
+  CaptureThread(CaptureThread&&) = delete;
+  CaptureThread& operator=(const CaptureThread&) = delete;
+  CaptureThread& operator=(CaptureThread&&) = delete;
+
+  // Requests a stop, waits for the thread and rethrows its error
+  void join();
+  // Captured frames and time, valid after `join`
+  [[nodiscard]] std::uint64_t frames() const noexcept;
+  [[nodiscard]] std::chrono::duration<double> elapsed() const noexcept;
+
+  ~CaptureThread();
+};
+
+#endif
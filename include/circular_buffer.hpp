@@ -28,6 +28,10 @@
 #include <cstddef>
 #include <mutex>
 
+// Ring of the latest values guarded by a mutex, the handover of the former
+// queue thread. Pipeline stages are connected by `FrameQueue`s instead,
+// it is kept as the baseline they are compared with in the `buffers`
+// benchmark.
 template <std::default_initializable T, std::size_t size>
 class CircularBuffer {
   std::mutex mutex{};
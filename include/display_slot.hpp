@@ -0,0 +1,75 @@
+// MIT License
+//
+// Copyright (c) 2021-2022 char-lie
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef DISPLAY_SLOT_HPP
+#define DISPLAY_SLOT_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include "frame.hpp"
+
+// Hands the latest frame of a stage over to the thread that shows it.
+//
+// Triple buffer: the producer fills its back buffer and swaps it with the
+// middle one, the consumer swaps its front buffer with the middle one,
+// so neither of them ever waits for the other.
+// One producer and one consumer thread at a time.
+class DisplaySlot {
+  static constexpr std::uint8_t index_mask{3U};
+  // Set in `middle` when it holds a frame that is not taken yet
+  static constexpr std::uint8_t fresh_flag{4U};
+
+  struct Buffer {
+    Frame frame{};
+    // Publication order, starting from 1
+    std::uint64_t sequence{0U};
+  };
+
+  std::array<Buffer, 3> buffers{};
+  std::atomic<std::uint8_t> middle{1U};
+  // Owned by the producer
+  std::uint8_t back{0U};
+  std::uint64_t published{0U};
+  // Owned by the consumer
+  std::uint8_t front{2U};
+  std::uint64_t taken_sequence{0U};
+  std::atomic<std::uint64_t> skipped_count{0U};
+
+ public:
+  const std::string window_name;
+
+  explicit DisplaySlot(std::string cv_window_name);
+
+  // Replaces the frame that is not taken yet
+  void publish(Frame new_frame);
+  // Returns the frame if there is a new one
+  std::optional<Frame> take();
+  // Published frames replaced before being taken, safe to read from any
+  // thread
+  [[nodiscard]] std::uint64_t skipped() const noexcept;
+};
+
+#endif
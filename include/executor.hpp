@@ -0,0 +1,203 @@
+// MIT License
+//
+// Copyright (c) 2021-2022 char-lie
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef EXECUTOR_HPP
+#define EXECUTOR_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "thread_settings.hpp"
+
+class Task;
+
+// Runs coroutines on a fixed set of threads.
+//
+// Every thread resumes the coroutines of its own queue in order and steals
+// from the back of the other queues when its own runs out. Idle threads
+// are woken only when there are any, so a busy executor passes coroutines
+// around without system calls.
+class Executor {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  // Coroutines of one client, e.g. of one pipeline
+  class Group {
+    Executor& executor;
+    std::mutex mutex{};
+    std::condition_variable finished{};
+    std::size_t running_tasks{0U};
+
+    friend class Task;
+    void finish_task();
+
+   public:
+    explicit Group(Executor& group_executor);
+    Group(const Group&) = delete;
+    Group(Group&&) = delete;
+    Group& operator=(const Group&) = delete;
+    Group& operator=(Group&&) = delete;
+
+    void spawn(Task task);
+    // Waits until every spawned coroutine has returned
+    void wait();
+
+    ~Group();
+  };
+
+  // `co_await` resumes the coroutine at `time` on one of the threads
+  class SleepAwaiter {
+    Executor& executor;
+    Clock::time_point time;
+
+   public:
+    SleepAwaiter(Executor& sleep_executor, Clock::time_point resume_time);
+
+    [[nodiscard]] bool await_ready() const noexcept;
+    void await_suspend(std::coroutine_handle<> handle) const;
+    void await_resume() const noexcept;
+  };
+
+  // `co_await` moves the coroutine to the back of the line,
+  // unless no other coroutine is waiting for a thread
+  class YieldAwaiter {
+    Executor& executor;
+
+   public:
+    explicit YieldAwaiter(Executor& yield_executor);
+
+    [[nodiscard]] bool await_ready() const noexcept;
+    void await_suspend(std::coroutine_handle<> handle) const;
+    void await_resume() const noexcept;
+  };
+
+ private:
+  struct Worker {
+    std::mutex mutex{};
+    std::deque<std::coroutine_handle<>> ready{};
+  };
+
+  struct Timer {
+    Clock::time_point time;
+    std::coroutine_handle<> handle;
+
+    bool operator>(const Timer& other) const noexcept;
+  };
+
+  std::vector<std::unique_ptr<Worker>> workers{};
+  // Queued coroutines of all workers
+  std::atomic<std::size_t> ready_count{0U};
+  std::atomic<std::size_t> sleeping_threads{0U};
+  // Worker for coroutines scheduled by other threads
+  std::atomic<std::size_t> next_worker{0U};
+  std::atomic<std::uint64_t> steal_count{0U};
+  // Earliest timer in `Clock` ticks, checked without the lock
+  std::atomic<Clock::rep> next_timer;
+
+  std::mutex mutex{};
+  std::condition_variable work_available{};
+  std::priority_queue<Timer, std::vector<Timer>, std::greater<>> timers{};
+  bool is_finished{false};
+  std::vector<std::thread> threads{};
+
+  void run(std::size_t worker_index);
+  std::coroutine_handle<> take(std::size_t worker_index);
+  // Schedules the coroutines of due timers
+  void fire_timers();
+  void finish();
+
+ public:
+  explicit Executor(std::size_t thread_count,
+                    const ThreadSettings& thread_settings = {});
+  Executor(const Executor&) = delete;
+  Executor(Executor&&) = delete;
+  Executor& operator=(const Executor&) = delete;
+  Executor& operator=(Executor&&) = delete;
+
+  // Queues the coroutine on the calling thread if it belongs to the
+  // executor, so a chain of stages stays on one core
+  void schedule(std::coroutine_handle<> handle);
+  [[nodiscard]] SleepAwaiter sleep_until(Clock::time_point time);
+  [[nodiscard]] SleepAwaiter sleep_for(Clock::duration duration);
+  [[nodiscard]] YieldAwaiter yield();
+
+  [[nodiscard]] std::size_t size() const noexcept;
+  // Coroutines taken from the queue of another thread
+  [[nodiscard]] std::uint64_t steals() const noexcept;
+
+  // Groups should be destroyed first, coroutines suspended on timers
+  // at that time are never resumed
+  ~Executor();
+};
+
+// Coroutine that runs on an executor once spawned by `Executor::Group`.
+// Exceptions should be handled in its body.
+class Task {
+ public:
+  struct promise_type;
+  using Handle = std::coroutine_handle<promise_type>;
+
+  struct FinalAwaiter {
+    [[nodiscard]] bool await_ready() const noexcept;
+    void await_suspend(Handle handle) const noexcept;
+    void await_resume() const noexcept;
+  };
+
+  struct promise_type {
+    Executor::Group* group{nullptr};
+
+    Task get_return_object() noexcept;
+    // Started by `Executor::Group::spawn`
+    [[nodiscard]] std::suspend_always initial_suspend() const noexcept;
+    [[nodiscard]] FinalAwaiter final_suspend() const noexcept;
+    void return_void() const noexcept;
+    [[noreturn]] void unhandled_exception() const noexcept;
+  };
+
+ private:
+  friend class Executor::Group;
+  Handle handle;
+
+  explicit Task(Handle coroutine) noexcept;
+
+ public:
+  Task(const Task&) = delete;
+  Task(Task&& other) noexcept;
+  Task& operator=(const Task&) = delete;
+  Task& operator=(Task&& other) noexcept;
+
+  // Destroys the coroutine unless it was spawned
+  ~Task();
+};
+
+#endif
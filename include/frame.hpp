@@ -20,21 +20,23 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
-#ifndef CLOCK_THREAD_HPP
-#define CLOCK_THREAD_HPP
+#ifndef FRAME_HPP
+#define FRAME_HPP
 
-#include <cstddef>
+#include <chrono>
+#include <cstdint>
 #include <opencv2/core/mat.hpp>
 
-#include "average_intensity_calculator.hpp"
-#include "thread_handle.hpp"
-
-void clock_thread(ThreadHandle &thread_handle,
-                  AverageIntensityCalculator &average_intensity_calculator,
-                  std::size_t threshold);
-
-void process_t2(ThreadHandle &clock_thread_handle, cv::Mat &image,
-                std::chrono::time_point<std::chrono::system_clock>
-                    &previous_frame_push_time);
+struct Frame {
+  // May be shared between stages: never modify it in place
+  cv::Mat image{};
+  // Capture order, starting from 1
+  std::uint64_t index{0U};
+  std::chrono::steady_clock::time_point capture_time{};
+  // Index of the first of the frames that look the same according to
+  // the change detection, which stages may answer with their previous
+  // output; 0 without the detection
+  std::uint64_t content_index{0U};
+};
 
 #endif
@@ -0,0 +1,76 @@
+// MIT License
+//
+// Copyright (c) 2021-2022 char-lie
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef FRAME_BANDS_HPP
+#define FRAME_BANDS_HPP
+
+#include <algorithm>
+#include <concepts>
+#include <cstdint>
+#include <opencv2/core.hpp>
+#include <opencv2/core/mat.hpp>
+#include <opencv2/core/utility.hpp>
+
+// Number of bands to split `rows` rows into when asked for `bands`:
+// at least one and no more than there are `alignment` row units,
+// so every band has rows
+inline int band_count(const int bands, const int rows,
+                      const int alignment = 1) {
+  return std::max(std::min(bands, (rows + alignment - 1) / alignment), 1);
+}
+
+// Rows of the `band`-th of `bands` horizontal bands of `rows` rows.
+// Band boundaries are multiples of `alignment`, so tiles are not split.
+inline cv::Range band_rows(const int band, const int bands, const int rows,
+                           const int alignment = 1) {
+  // The product of two `int`s does not overflow
+  const std::int64_t units{(rows + alignment - 1) / alignment};
+  const auto boundary{[units, bands, rows, alignment](const int index) {
+    return static_cast<int>(
+        std::min<std::int64_t>(units * index / bands * alignment, rows));
+  }};
+  return {boundary(band), boundary(band + 1)};
+}
+
+// Calls `function` with the rows of every band, in parallel on the OpenCV
+// threads if there are several bands. Intra-frame parallelism cuts the
+// latency of a single large frame, not only the throughput.
+template <typename F>
+requires std::invocable<F, cv::Range> void for_each_band(const int rows,
+                                                         const int bands,
+                                                         const int alignment,
+                                                         F function) {
+  const int count{band_count(bands, rows, alignment)};
+  if (count == 1) {
+    function(cv::Range{0, rows});
+    return;
+  }
+  cv::parallel_for_(
+      cv::Range{0, count},
+      [&function, count, rows, alignment](const cv::Range& range) {
+        for (int band{range.start}; band < range.end; ++band) {
+          function(band_rows(band, count, rows, alignment));
+        }
+      });
+}
+
+#endif
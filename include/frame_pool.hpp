@@ -0,0 +1,100 @@
+// MIT License
+//
+// Copyright (c) 2021-2022 char-lie
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef FRAME_POOL_HPP
+#define FRAME_POOL_HPP
+
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <opencv2/core/mat.hpp>
+#include <unordered_map>
+#include <vector>
+
+// Allocator that keeps the buffers of released 2D frames for reuse.
+//
+// Set it as `cv::Mat::allocator` of an output matrix (or get one with
+// `acquire`) and the buffer returns to the pool once the last `cv::Mat`
+// header referencing it is gone. The pool should outlive all such matrices.
+class FramePool : public cv::MatAllocator {
+ public:
+  struct Stats {
+    std::size_t hits{0U};
+    std::size_t misses{0U};
+    // Buffers held by matrices
+    std::size_t used_bytes{0U};
+    // Buffers waiting for reuse
+    std::size_t idle_bytes{0U};
+    // Maximum of `used_bytes + idle_bytes`
+    std::size_t peak_bytes{0U};
+  };
+
+ private:
+  struct Key {
+    int rows{0};
+    int cols{0};
+    int type{0};
+
+    bool operator==(const Key&) const = default;
+  };
+
+  struct KeyHash {
+    std::size_t operator()(const Key& key) const noexcept;
+  };
+
+  struct PooledData;
+
+  // Idle buffers above this limit are freed instead of pooled
+  std::size_t max_idle_bytes;
+  mutable std::mutex mutex{};
+  mutable std::unordered_map<Key, std::vector<void*>, KeyHash> idle_buffers{};
+  mutable Stats statistics{};
+
+ public:
+  static constexpr std::size_t default_max_idle_bytes{std::size_t{256U}
+                                                      << 20U};
+
+  explicit FramePool(std::size_t max_idle_size = default_max_idle_bytes);
+  FramePool(const FramePool&) = delete;
+  FramePool(FramePool&&) = delete;
+  FramePool& operator=(const FramePool&) = delete;
+  FramePool& operator=(FramePool&&) = delete;
+
+  cv::Mat acquire(cv::Size size, int type);
+  // Makes `count` buffers ready for `acquire` without allocating.
+  // Their memory is touched by the calling thread.
+  void reserve(cv::Size size, int type, std::size_t count);
+  [[nodiscard]] Stats stats() const;
+  // Frees all idle buffers
+  void trim();
+
+  cv::UMatData* allocate(int dims, const int* sizes, int type, void* data,
+                         size_t* step, cv::AccessFlag flags,
+                         cv::UMatUsageFlags usage_flags) const override;
+  bool allocate(cv::UMatData* data, cv::AccessFlag access_flags,
+                cv::UMatUsageFlags usage_flags) const override;
+  void deallocate(cv::UMatData* data) const override;
+
+  ~FramePool() override;
+};
+
+#endif
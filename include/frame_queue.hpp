@@ -0,0 +1,115 @@
+// MIT License
+//
+// Copyright (c) 2021-2022 char-lie
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef FRAME_QUEUE_HPP
+#define FRAME_QUEUE_HPP
+
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+#include "executor.hpp"
+#include "frame.hpp"
+
+// What `FrameQueue::push` does with a frame that does not fit
+enum class QueuePolicy {
+  // Discards the oldest queued frame
+  drop_oldest,
+  // Discards the pushed frame
+  drop_newest,
+  // Waits for a free place, slowing the producer down
+  block,
+  // Discards all queued frames on every push, regardless of the capacity
+  latest_only,
+};
+
+// Bounded queue between pipeline stages.
+// Its policy decides what a push into a full queue discards,
+// only `QueuePolicy::block` makes producers wait.
+class FrameQueue {
+ public:
+  struct Entry {
+    Frame frame;
+    // Pop order, starting from 0
+    std::uint64_t sequence;
+  };
+
+  // `co_await` waits for a frame without holding the thread and resumes
+  // the coroutine on the `executor` with the frame, or with `std::nullopt`
+  // once the queue is closed
+  class PopAwaiter {
+    friend class FrameQueue;
+
+    FrameQueue& queue;
+    Executor& executor;
+    std::optional<Entry> entry{};
+    std::coroutine_handle<> handle{};
+
+   public:
+    PopAwaiter(FrameQueue& frame_queue, Executor& resume_executor);
+
+    [[nodiscard]] bool await_ready() const noexcept;
+    bool await_suspend(std::coroutine_handle<> coroutine);
+    std::optional<Entry> await_resume();
+  };
+
+ private:
+  std::mutex mutex{};
+  std::condition_variable condition_variable{};
+  std::condition_variable not_full{};
+  std::deque<Frame> frames{};
+  std::size_t capacity;
+  QueuePolicy policy;
+  std::size_t dropped_frames{0U};
+  std::uint64_t popped_frames{0U};
+  bool is_closed{false};
+  // Suspended consumers, a pushed frame goes straight to the first one
+  std::deque<PopAwaiter*> waiters{};
+
+ public:
+  explicit FrameQueue(std::size_t queue_capacity,
+                      QueuePolicy queue_policy = QueuePolicy::drop_oldest);
+  FrameQueue(const FrameQueue&) = delete;
+  FrameQueue(FrameQueue&&) = delete;
+  FrameQueue& operator=(const FrameQueue&) = delete;
+  FrameQueue& operator=(FrameQueue&&) = delete;
+
+  void push(Frame frame);
+  // Waits for a frame. Returns `std::nullopt` once the queue is closed.
+  std::optional<Entry> pop();
+  // Returns `std::nullopt` if the queue is empty or closed
+  std::optional<Entry> try_pop();
+  [[nodiscard]] PopAwaiter async_pop(Executor& executor);
+  void close();
+
+  [[nodiscard]] std::size_t size();
+  // Frames discarded by the policy
+  [[nodiscard]] std::size_t dropped();
+
+  ~FrameQueue() = default;
+};
+
+#endif
@@ -0,0 +1,89 @@
+// MIT License
+//
+// Copyright (c) 2021-2022 char-lie
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef FRAME_SINK_HPP
+#define FRAME_SINK_HPP
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+
+#include "frame.hpp"
+#include "shared_frame_ring.hpp"
+
+class FrameSink {
+ public:
+  FrameSink() = default;
+  FrameSink(const FrameSink&) = delete;
+  FrameSink(FrameSink&&) noexcept = default;
+  FrameSink& operator=(const FrameSink&) = delete;
+  FrameSink& operator=(FrameSink&&) noexcept = default;
+
+  virtual void show(const std::string& window_name, const Frame& frame) = 0;
+  // Handles pending UI events.
+  // Returns `false` when the user asked to stop.
+  virtual bool poll() = 0;
+
+  virtual ~FrameSink() = default;
+};
+
+class HighGuiFrameSink : public FrameSink {
+  std::set<std::string> windows{};
+
+ public:
+  void show(const std::string& window_name, const Frame& frame) override;
+  bool poll() override;
+};
+
+// Drops the frames and only counts them per window
+class NullFrameSink : public FrameSink {
+  std::map<std::string, std::size_t> frame_counts{};
+
+ public:
+  void show(const std::string& window_name, const Frame& frame) override;
+  bool poll() override;
+
+  [[nodiscard]] const std::map<std::string, std::size_t>& counts()
+      const noexcept;
+};
+
+// Publishes the frames of every window to its own shared frame ring
+// named by `shared_frame_ring_name(prefix, window_name)`,
+// created with the first frame of the window and sized for it.
+// A larger frame replaces the ring with one sized for that frame.
+class SharedMemoryFrameSink : public FrameSink {
+  std::string prefix;
+  std::map<std::string, SharedFrameRingWriter> rings{};
+
+ public:
+  explicit SharedMemoryFrameSink(std::string name_prefix);
+
+  void show(const std::string& window_name, const Frame& frame) override;
+  bool poll() override;
+};
+
+// Creates a sink by its name: `highgui`, `null` or `shm:PREFIX`
+std::unique_ptr<FrameSink> make_frame_sink(const std::string& name);
+
+#endif
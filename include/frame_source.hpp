@@ -0,0 +1,136 @@
+// MIT License
+//
+// Copyright (c) 2021-2022 char-lie
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef FRAME_SOURCE_HPP
+#define FRAME_SOURCE_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <opencv2/core/mat.hpp>
+#include <opencv2/videoio.hpp>
+#include <string>
+#include <vector>
+
+#include "frame_store.hpp"
+
+class FrameSource {
+ public:
+  FrameSource() = default;
+  FrameSource(const FrameSource&) = delete;
+  FrameSource(FrameSource&&) noexcept = default;
+  FrameSource& operator=(const FrameSource&) = delete;
+  FrameSource& operator=(FrameSource&&) noexcept = default;
+
+  // Returns `false` when the source is exhausted
+  virtual bool read(cv::Mat& frame) = 0;
+  // Whether frames are encoded images for a `DecodeStage`
+  [[nodiscard]] virtual bool is_compressed() const noexcept { return false; }
+
+  virtual ~FrameSource() = default;
+};
+
+// Camera or video file
+class VideoFrameSource : public FrameSource {
+  cv::VideoCapture capture;
+
+ public:
+  explicit VideoFrameSource(int camera);
+  explicit VideoFrameSource(const std::string& path);
+
+  bool read(cv::Mat& frame) override;
+};
+
+// Decodes all images of a directory upfront and cycles through them,
+// so decoding does not count against the pipeline throughput
+class ImageDirectoryFrameSource : public FrameSource {
+  std::vector<cv::Mat> images{};
+  std::size_t next_image{0U};
+
+ public:
+  explicit ImageDirectoryFrameSource(const std::string& directory);
+
+  bool read(cv::Mat& frame) override;
+};
+
+// MJPEG camera or video file read without decoding: every frame is a
+// single-row 8-bit buffer with a JPEG image, so decoding can run
+// on other threads
+class MjpegFrameSource : public FrameSource {
+  cv::VideoCapture capture;
+
+ public:
+  explicit MjpegFrameSource(int camera);
+  explicit MjpegFrameSource(const std::string& path);
+
+  bool read(cv::Mat& frame) override;
+  [[nodiscard]] bool is_compressed() const noexcept override;
+};
+
+enum class SyntheticPattern { gradient, checkerboard, noise };
+
+// Generates moving 8-bit 3-channel frames without any device.
+// Zero `fps` means "as fast as possible".
+class SyntheticFrameSource : public FrameSource {
+  cv::Size resolution;
+  std::chrono::steady_clock::duration period{};
+  SyntheticPattern pattern;
+  std::uint64_t frame_number{0U};
+  std::chrono::steady_clock::time_point next_frame_time{};
+
+  void draw(cv::Mat& frame) const;
+
+ public:
+  SyntheticFrameSource(cv::Size frame_resolution, double fps,
+                       SyntheticPattern frame_pattern);
+
+  bool read(cv::Mat& frame) override;
+};
+
+// Replays a `FrameStoreWriter` recording in a loop, either with the
+// recorded timing or as fast as possible. Frames are the mapped pixels of
+// the recording and should not outlive the source.
+class ReplayFrameSource : public FrameSource {
+  FrameStoreReader reader;
+  bool is_timed;
+  std::size_t next_frame{0U};
+  std::chrono::steady_clock::time_point pass_start_time{};
+
+ public:
+  ReplayFrameSource(const std::string& path, bool keep_timing);
+
+  bool read(cv::Mat& frame) override;
+};
+
+// Creates a source from its description:
+// - `camera:INDEX`
+// - `video:PATH`
+// - `mjpeg-camera:INDEX` and `mjpeg:PATH`, compressed frames
+// - `images:DIRECTORY`
+// - `synthetic:RESOLUTION[@FPS][:PATTERN]`, where `RESOLUTION` is either
+//   `WIDTHxHEIGHT` or one of `720p`, `1080p`, `4k`, and `PATTERN` is one of
+//   `gradient`, `checkerboard`, `noise`
+// - `replay:PATH` and `replay-fast:PATH`, see `ReplayFrameSource`
+std::unique_ptr<FrameSource> make_frame_source(const std::string& description);
+
+#endif
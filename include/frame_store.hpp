@@ -0,0 +1,97 @@
+// MIT License
+//
+// Copyright (c) 2021-2022 char-lie
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef FRAME_STORE_HPP
+#define FRAME_STORE_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <opencv2/core/mat.hpp>
+#include <string>
+#include <vector>
+
+// Append-only file of raw frames. Every record is a header with the
+// timestamp, index, geometry and type of the frame followed by its pixels,
+// both aligned to `frame_store_alignment` bytes, so a mapped file can be
+// used in place. A recording cut short loses only its last record.
+inline constexpr std::size_t frame_store_alignment{64U};
+
+class FrameStoreWriter {
+  std::ofstream file;
+  std::uint64_t frame_count{0U};
+  std::chrono::steady_clock::time_point first_frame_time{};
+
+  void write(const void* data, std::size_t size);
+  void pad(std::size_t size);
+
+ public:
+  explicit FrameStoreWriter(const std::string& path);
+  FrameStoreWriter(const FrameStoreWriter&) = delete;
+  FrameStoreWriter(FrameStoreWriter&&) noexcept = default;
+  FrameStoreWriter& operator=(const FrameStoreWriter&) = delete;
+  FrameStoreWriter& operator=(FrameStoreWriter&&) noexcept = default;
+
+  // Timestamps are stored relative to the first frame
+  void append(const cv::Mat& frame,
+              std::chrono::steady_clock::time_point capture_time);
+  [[nodiscard]] std::uint64_t frames() const noexcept;
+
+  ~FrameStoreWriter() = default;
+};
+
+class FrameStoreReader {
+ public:
+  struct Record {
+    // Since the first frame
+    std::chrono::nanoseconds timestamp{};
+    std::uint64_t index{0U};
+    cv::Size size{};
+    int type{0};
+    // Of the pixels from the beginning of the file
+    std::size_t offset{0U};
+  };
+
+ private:
+  void* mapping{nullptr};
+  std::size_t mapping_size{0U};
+  std::vector<Record> records{};
+
+ public:
+  explicit FrameStoreReader(const std::string& path);
+  FrameStoreReader(const FrameStoreReader&) = delete;
+  FrameStoreReader(FrameStoreReader&&) = delete;
+  FrameStoreReader& operator=(const FrameStoreReader&) = delete;
+  FrameStoreReader& operator=(FrameStoreReader&&) = delete;
+
+  [[nodiscard]] std::size_t size() const noexcept;
+  [[nodiscard]] const Record& record(std::size_t position) const;
+  // Wraps the mapped pixels without copying: the frame is valid while the
+  // reader exists. The mapping is private, so writes to the frame are
+  // neither shared nor stored.
+  [[nodiscard]] cv::Mat frame(std::size_t position) const;
+
+  ~FrameStoreReader();
+};
+
+#endif
@@ -0,0 +1,51 @@
+// MIT License
+//
+// Copyright (c) 2021-2022 char-lie
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef FRAME_TRANSFORM_HPP
+#define FRAME_TRANSFORM_HPP
+
+#include <opencv2/core.hpp>
+#include <opencv2/core/mat.hpp>
+#include <optional>
+
+// Converts an 8-bit 3-channel frame to grayscale and rotates it
+// in one cache-blocked pass, without an intermediate grayscale image.
+// The result matches `cv::cvtColor` with `cv::COLOR_RGB2GRAY`
+// followed by `cv::rotate`.
+// Several `bands` of tile rows are processed in parallel.
+void gray_rotate(const cv::Mat& frame, cv::Mat& result,
+                 std::optional<cv::RotateFlags> rotation, int bands = 1);
+
+// Processes only the `tile` of the frame, `result` should be allocated
+void gray_rotate_tile(const cv::Mat& frame, cv::Mat& result,
+                      cv::RotateFlags rotation, cv::Rect tile);
+
+// `cv::flip` around the vertical axis, `bands` of rows in parallel.
+// `result` should be allocated and differ from `frame`.
+void mirror(const cv::Mat& frame, cv::Mat& result, int bands = 1);
+
+// Coarse signature of a frame for change detection: the means of the blocks
+// of a 32x18 grid. The area downsampling reads every pixel once,
+// so a local change still moves the mean of its block.
+void frame_signature(const cv::Mat& frame, cv::Mat& signature);
+
+#endif
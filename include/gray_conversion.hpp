@@ -20,43 +20,28 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
-#ifndef THREAD_HANDLE_HPP
-#define THREAD_HANDLE_HPP
+#ifndef GRAY_CONVERSION_HPP
+#define GRAY_CONVERSION_HPP
 
-#include <concepts>
-#include <condition_variable>
-#include <mutex>
 #include <opencv2/core/mat.hpp>
-#include <optional>
-#include <string>
 
-struct ThreadHandle {
- private:
-  std::mutex mutex{};
-  std::condition_variable condition_variable{};
-  bool is_finished{false};
-
- public:
-  std::optional<cv::Mat> output_image{};
-  std::mutex image_mutex{};
-  std::string window_name;
-  bool waiting{true};
-
-  explicit ThreadHandle(std::string cv_window_name);
-
-  bool need_stop();
-  bool try_show_image();
-  void finish();
-  template <typename F>
-  requires std::invocable<F> void push_image(F pusher);
-};
-
-template <typename F>
-requires std::invocable<F> void ThreadHandle::push_image(F pusher) {
-  std::lock_guard lock{this->image_mutex};
-  pusher();
-  this->waiting = false;
-  this->condition_variable.notify_one();
+// Fixed-point weights of `cv::COLOR_RGB2GRAY` for 8-bit images:
+// gray = (4899 * first + 9617 * second + 1868 * third + 2^13) >> 14
+inline constexpr int gray_shift{14};
+inline constexpr int gray_first_weight{4899};
+inline constexpr int gray_second_weight{9617};
+inline constexpr int gray_third_weight{1868};
+static_assert(gray_first_weight + gray_second_weight + gray_third_weight ==
+              1 << gray_shift);
+
+// Exactly what `cv::cvtColor(..., cv::COLOR_RGB2GRAY)` computes for a pixel
+constexpr uchar rgb_to_gray(const uchar first, const uchar second,
+                            const uchar third) noexcept {
+  constexpr int rounding{1 << (gray_shift - 1)};
+  return static_cast<uchar>(
+      (gray_first_weight * first + gray_second_weight * second +
+       gray_third_weight * third + rounding) >>
+      gray_shift);
 }
 
 #endif
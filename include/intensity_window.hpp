@@ -0,0 +1,82 @@
+// MIT License
+//
+// Copyright (c) 2021-2022 char-lie
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef INTENSITY_WINDOW_HPP
+#define INTENSITY_WINDOW_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "opencv2/core/mat.hpp"
+
+// Grayscale intensity statistics of the last `length` frames.
+// Every added frame is scanned once; the window aggregates are updated by
+// adding its histogram and subtracting the one of the evicted frame, so the
+// cost does not depend on the window length.
+class IntensityWindow {
+ public:
+  static constexpr std::size_t histogram_bars{256U};
+  using Histogram = std::array<std::uint64_t, histogram_bars>;
+
+  struct Statistics {
+    std::uint64_t pixel_count{0U};
+    double mean{0.0};
+    double variance{0.0};
+    uchar min{0U};
+    uchar max{0U};
+  };
+
+ private:
+  struct FrameSummary {
+    Histogram histogram{};
+    std::uint64_t sum{0U};
+    std::uint64_t squares_sum{0U};
+    std::uint64_t pixel_count{0U};
+  };
+
+  // Ring of the frames in the window, `next` is overwritten first
+  std::vector<FrameSummary> frames;
+  std::size_t next{0U};
+  std::size_t frame_count{0U};
+  FrameSummary window{};
+
+  static Statistics statistics_of(const FrameSummary& summary);
+
+ public:
+  explicit IntensityWindow(std::size_t length);
+
+  // Adds a 3-channel frame and evicts the oldest one if the window is full
+  void add(const cv::Mat& image);
+  void clear() noexcept;
+
+  [[nodiscard]] std::size_t size() const noexcept;
+  [[nodiscard]] std::size_t length() const noexcept;
+  // Statistics of the last added frame
+  [[nodiscard]] Statistics frame_statistics() const;
+  // Statistics of all pixels of all frames in the window
+  [[nodiscard]] Statistics statistics() const;
+  [[nodiscard]] const Histogram& histogram() const noexcept;
+};
+
+#endif
@@ -0,0 +1,147 @@
+// MIT License
+//
+// Copyright (c) 2021-2022 char-lie
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Log-linear histogram of durations: every power of two is split into
+// 2^`sub_bucket_bits` buckets, so values are kept within 1/16 precision.
+// Recording is lock-free.
+class LatencyHistogram {
+ public:
+  static constexpr int sub_bucket_bits{4};
+  static constexpr std::size_t bucket_count{
+      static_cast<std::size_t>(64 - sub_bucket_bits + 1) << sub_bucket_bits};
+
+  struct Snapshot {
+    std::vector<std::uint64_t> buckets{};
+    std::uint64_t count{0U};
+    std::uint64_t sum_ns{0U};
+    std::uint64_t max_ns{0U};
+
+    // Upper bound of the `quantile` in nanoseconds
+    [[nodiscard]] std::uint64_t quantile_ns(double quantile) const;
+    // Number of values that are certainly not greater than `bound_ns`
+    [[nodiscard]] std::uint64_t count_not_above(std::uint64_t bound_ns) const;
+  };
+
+ private:
+  std::array<std::atomic<std::uint64_t>, bucket_count> buckets{};
+  std::atomic<std::uint64_t> count{0U};
+  std::atomic<std::uint64_t> sum_ns{0U};
+  std::atomic<std::uint64_t> max_ns{0U};
+
+ public:
+  static std::size_t bucket_of(std::uint64_t value_ns) noexcept;
+  // The greatest value of the bucket
+  static std::uint64_t upper_bound_of(std::size_t bucket) noexcept;
+
+  void record(std::chrono::nanoseconds duration) noexcept;
+  [[nodiscard]] Snapshot snapshot() const;
+};
+
+class Counter {
+  std::atomic<std::uint64_t> value{0U};
+
+ public:
+  void add(std::uint64_t increment = 1U) noexcept {
+    this->value.fetch_add(increment, std::memory_order_relaxed);
+  }
+  [[nodiscard]] std::uint64_t get() const noexcept {
+    return this->value.load(std::memory_order_relaxed);
+  }
+};
+
+// Registry of named metrics.
+// Registration locks, so hot paths should keep the returned references.
+class Metrics {
+  std::mutex mutex{};
+  std::deque<std::pair<std::string, LatencyHistogram>> histograms{};
+  std::deque<std::pair<std::string, Counter>> counters{};
+  std::vector<std::pair<std::string, std::function<double()>>> gauges{};
+
+ public:
+  Metrics() = default;
+  Metrics(const Metrics&) = delete;
+  Metrics(Metrics&&) = delete;
+  Metrics& operator=(const Metrics&) = delete;
+  Metrics& operator=(Metrics&&) = delete;
+
+  // Returns the metric with the `name`, creating it if needed
+  LatencyHistogram& histogram(const std::string& name);
+  Counter& counter(const std::string& name);
+  // `read` is called on every export
+  void gauge(std::string name, std::function<double()> read);
+
+  // Prometheus text exposition format
+  void write_prometheus(std::ostream& stream);
+  // One row per metric: `time,name,count,mean_ns,p50_ns,p90_ns,p99_ns,
+  // p999_ns,max_ns`, counters and gauges fill only `count`
+  void write_csv(std::ostream& stream,
+                 std::chrono::system_clock::time_point time);
+  static void write_csv_header(std::ostream& stream);
+
+  ~Metrics() = default;
+};
+
+// Dumps the metrics to a file every `interval` and once more when destroyed.
+// Files ending with `.csv` get a new block of rows on every dump, others are
+// rewritten in the Prometheus format.
+class MetricsReporter {
+  Metrics& metrics;
+  std::string path;
+  std::chrono::steady_clock::duration interval;
+  std::mutex mutex{};
+  std::condition_variable condition_variable{};
+  bool is_finished{false};
+  std::thread thread{};
+
+  void dump();
+  void run();
+
+ public:
+  MetricsReporter(Metrics& reported_metrics, std::string file_path,
+                  std::chrono::steady_clock::duration dump_interval);
+  MetricsReporter(const MetricsReporter&) = delete;
+  MetricsReporter(MetricsReporter&&) = delete;
+  MetricsReporter& operator=(const MetricsReporter&) = delete;
+  MetricsReporter& operator=(MetricsReporter&&) = delete;
+
+  ~MetricsReporter();
+};
+
+#endif
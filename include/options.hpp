@@ -0,0 +1,94 @@
+// MIT License
+//
+// Copyright (c) 2021-2022 char-lie
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef OPTIONS_HPP
+#define OPTIONS_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "frame_queue.hpp"
+#include "thread_settings.hpp"
+
+struct Options {
+  std::size_t threshold{0U};
+  // One stream per source, `camera:0` if none is given
+  std::vector<std::string> sources{};
+  std::string sink{"highgui"};
+  std::optional<std::size_t> frame_limit{};
+  std::optional<std::chrono::duration<double>> duration_limit{};
+  // Every `decimation`-th frame is converted and rotated.
+  // Without it frames are converted as fast as the conversion keeps up.
+  std::optional<std::size_t> decimation{};
+  std::size_t transform_workers{1U};
+  // Horizontal bands of a frame converted, averaged and flipped in parallel
+  // on the OpenCV threads, which cuts the latency of large frames
+  int frame_bands{1};
+  // Threads decoding the frames of compressed sources in parallel
+  std::size_t decode_workers{1U};
+  // Frames within this many intensity levels of the last changed frame
+  // in every block of their signatures reuse its results
+  std::optional<std::size_t> change_threshold{};
+  // Input queue policies by stage name, e.g. `gray_rotate`
+  std::map<std::string, QueuePolicy> queue_policies{};
+  // Threads shared by the stages of all streams instead of a thread per
+  // stage; multiple sources use all hardware threads by default
+  std::optional<std::size_t> pool_threads{};
+  // Threads of an executor running the stages as coroutines,
+  // instead of the worker pool
+  std::optional<std::size_t> executor_threads{};
+  // Placement by stage name or `capture`, `render` and `pool` (also the
+  // executor) for the other threads, applied to every stream
+  std::map<std::string, ThreadSettings> thread_settings{};
+  // Threads of the OpenCV parallel loops in the whole process,
+  // the OpenCV default if not set
+  std::optional<int> opencv_threads{};
+  // Frames whose mean intensity is compared to the threshold
+  std::size_t intensity_window{1U};
+  // Above 1 the intensity is estimated from a `stride`-strided sample
+  int intensity_stride{1};
+  // Compressed frames are decoded at 1/`scale` resolution for the intensity
+  int intensity_decode_scale{1};
+  // Captured frames are recorded there, with the stream index appended
+  // for multiple sources. Compressed frames are recorded decoded,
+  // so that replaying them needs no decoder.
+  std::optional<std::string> record_path{};
+  std::optional<std::string> metrics_path{};
+  std::chrono::duration<double> metrics_interval{1.0};
+};
+
+// Usage: `main THRESHOLD [--source SOURCE]... [--sink SINK] [--frames COUNT]
+// [--duration SECONDS] [--decimation PERIOD|auto] [--transform-workers COUNT]
+// [--frame-bands COUNT] [--decode-workers COUNT] [--change-threshold LEVELS]
+// [--queue-policy STAGE=drop-oldest|drop-newest|block|latest-only]...
+// [--pool-threads COUNT] [--executor-threads COUNT] [--affinity TARGET=CPUS]...
+// [--realtime-priority TARGET=PRIORITY]... [--opencv-threads COUNT]
+// [--intensity-window FRAMES] [--intensity-stride STRIDE]
+// [--intensity-decode-scale 1|2|4|8] [--record PATH] [--metrics PATH]
+// [--metrics-interval SECONDS]`
+Options parse_options(int argc, char* argv[]);
+
+#endif
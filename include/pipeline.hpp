@@ -0,0 +1,176 @@
+// MIT License
+//
+// Copyright (c) 2021-2022 char-lie
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef PIPELINE_HPP
+#define PIPELINE_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "executor.hpp"
+#include "frame.hpp"
+#include "frame_queue.hpp"
+#include "metrics.hpp"
+#include "reorder_buffer.hpp"
+#include "stage.hpp"
+#include "thread_settings.hpp"
+#include "worker_pool.hpp"
+
+struct StageOptions {
+  // Stream the stage consumes: a stream pushed into the pipeline
+  // or the output of another stage
+  std::string input;
+  // Stream the stage produces, empty for sinks
+  std::string output{};
+  std::size_t queue_capacity{1U};
+  // `QueuePolicy::block` is not allowed with a worker pool: a blocked task
+  // would hold a pool thread
+  QueuePolicy queue_policy{QueuePolicy::drop_oldest};
+  // Threads processing consecutive frames concurrently, their results are
+  // passed on in the input order. More than one worker requires
+  // `Stage::process` to be thread-safe.
+  // With a worker pool it limits the concurrent tasks of the stage instead,
+  // with an executor it is the number of coroutines of the stage.
+  std::size_t workers{1U};
+  // Runs the stage on its own threads even with a worker pool or an
+  // executor, for stages that block, e.g. on disk writes, and would hold
+  // a shared thread
+  bool dedicated_threads{false};
+  // Placement of the stage threads, unused on a worker pool or an executor
+  ThreadSettings thread_settings{};
+};
+
+// Directed acyclic graph of stages connected by bounded queues.
+//
+// Every stage runs on its own threads. A stream may have any number of
+// consumers: they share the frame without copying it.
+class Pipeline {
+  struct Node {
+    std::string name;
+    std::unique_ptr<Stage> stage;
+    // Set when the stage may suspend on an executor
+    CoroutineStage* coroutine_stage;
+    StageOptions options;
+    FrameQueue queue;
+    std::vector<Node*> consumers{};
+    std::vector<std::thread> threads{};
+    // Set when the stage runs on a worker pool
+    WorkerPool::Lane* lane{nullptr};
+    std::mutex schedule_mutex{};
+    // Tasks posted to the lane and not finished yet
+    std::size_t scheduled_tasks{0U};
+    ReorderBuffer reorder_buffer{};
+    std::mutex error_mutex{};
+    std::exception_ptr error{};
+    // Requested when the stage throws
+    std::stop_source error_stop_source{std::nostopstate};
+    LatencyHistogram* service_time{nullptr};
+    LatencyHistogram* latency{nullptr};
+    Counter* filtered_frames{nullptr};
+
+    Node(std::string node_name, std::unique_ptr<Stage> node_stage,
+         StageOptions node_options);
+    Node(const Node&) = delete;
+    Node(Node&&) = delete;
+    Node& operator=(const Node&) = delete;
+    Node& operator=(Node&&) = delete;
+    ~Node() = default;
+  };
+
+  std::vector<std::unique_ptr<Node>> nodes{};
+  std::map<std::string, std::vector<Node*>> consumers_by_stream{};
+  Metrics* metrics;
+  std::unique_ptr<WorkerPool::Lane> lane{};
+  Executor* executor{nullptr};
+  std::unique_ptr<Executor::Group> coroutines{};
+  std::stop_source error_stop_source{std::nostopstate};
+  bool is_running{false};
+
+  void connect();
+  void register_metrics();
+  static void deliver(const std::vector<Node*>& consumers, Frame frame);
+  static void process(Node& node, FrameQueue::Entry entry);
+  // Records the metrics of a processed frame and passes the output on
+  static void complete(Node& node, std::uint64_t sequence,
+                       std::optional<Frame> output,
+                       std::chrono::steady_clock::time_point start_time);
+  static void record_error(Node& node);
+  // Dedicated thread of a stage
+  static void run(Node& node);
+  // Worker pool task: processes one frame, so stages take turns
+  static void step(Node& node);
+  static void schedule(Node& node);
+  // Executor coroutine of a stage
+  static Task run_coroutine(Node& node, Executor& executor);
+
+ public:
+  // With `pipeline_metrics` every stage reports
+  // - `STAGE.service`: time spent in `Stage::process`, including the time
+  //   a coroutine stage is suspended;
+  // - `STAGE.latency`: time from the capture to the end of the stage;
+  // - `STAGE.filtered`: frames dropped by the stage;
+  // - `STAGE.queue_depth` and `STAGE.queue_dropped`: frames waiting in
+  //   the input queue and frames it dropped when full.
+  //
+  // With a `worker_pool` stages run as its tasks instead of on their own
+  // threads, in a lane shared by all stages of the pipeline.
+  //
+  // With an `executor` every stage is a coroutine waiting for its next
+  // frame, so idle stages cost neither a thread nor a wake-up.
+  // A busy stage yields after every frame, so stages take turns,
+  // and a `CoroutineStage` may suspend while it processes a frame.
+  explicit Pipeline(Metrics* pipeline_metrics = nullptr,
+                    WorkerPool* worker_pool = nullptr);
+  Pipeline(Metrics* pipeline_metrics, Executor& stage_executor);
+  Pipeline(const Pipeline&) = delete;
+  Pipeline(Pipeline&&) = delete;
+  Pipeline& operator=(const Pipeline&) = delete;
+  Pipeline& operator=(Pipeline&&) = delete;
+
+  void add(std::string name, std::unique_ptr<Stage> stage,
+           StageOptions options);
+  // Requests a stop from the `stop_source` when a stage throws,
+  // so that the producers stop feeding a failed pipeline.
+  // Takes effect on `start`.
+  void stop_on_error(std::stop_source stop_source);
+  // Checks the graph and starts the stages
+  void start();
+  // Feeds a stream that no stage produces
+  void push(const std::string& stream, Frame frame);
+  // Discards queued frames, waits for the stages to finish their current
+  // frames, including suspended coroutine stages, and rethrows the first
+  // exception thrown by a stage
+  void stop();
+
+  ~Pipeline();
+};
+
+#endif
@@ -0,0 +1,68 @@
+// MIT License
+//
+// Copyright (c) 2021-2022 char-lie
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef RATE_CONTROLLER_HPP
+#define RATE_CONTROLLER_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+
+// Admits frames to a consumer at the rate it sustains.
+// The consumer reports its service times, smoothed exponentially, and the
+// producer asks whether to pass each frame. Frames are admitted with a
+// token bucket refilled at `workers * target_utilization / service_time`
+// per second: a consumer faster than the producer gets every frame, an
+// overloaded one gets fewer frames instead of a growing backlog.
+class RateController {
+  std::mutex mutex{};
+  double workers;
+  double target_utilization;
+  double smoothing;
+  std::optional<double> service_seconds{};
+  double tokens{0.0};
+  std::optional<std::chrono::steady_clock::time_point> refill_time{};
+
+ public:
+  static constexpr double default_target_utilization{0.8};
+  static constexpr double default_smoothing{0.1};
+
+  explicit RateController(
+      std::size_t consumer_workers = 1U,
+      double consumer_target_utilization = default_target_utilization,
+      double service_time_smoothing = default_smoothing);
+  RateController(const RateController&) = delete;
+  RateController(RateController&&) = delete;
+  RateController& operator=(const RateController&) = delete;
+  RateController& operator=(RateController&&) = delete;
+
+  void record(std::chrono::steady_clock::duration service_time);
+  // Whether to pass a frame that arrived at `arrival_time`
+  bool admit(std::chrono::steady_clock::time_point arrival_time);
+  // Admitted frames per second, 0 before the first measurement
+  [[nodiscard]] double rate();
+
+  ~RateController() = default;
+};
+
+#endif
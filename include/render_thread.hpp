@@ -0,0 +1,74 @@
+// MIT License
+//
+// Copyright (c) 2021-2022 char-lie
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef RENDER_THREAD_HPP
+#define RENDER_THREAD_HPP
+
+#include <chrono>
+#include <deque>
+#include <exception>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#include "display_slot.hpp"
+#include "frame_sink.hpp"
+#include "metrics.hpp"
+#include "thread_settings.hpp"
+
+// Shows published frames and handles UI events on a dedicated thread,
+// which is the only one touching the `sink`.
+// Requests a stop when the user asks to.
+class RenderThread {
+  FrameSink& sink;
+  std::deque<DisplaySlot>& displays;
+  std::stop_source stop_source;
+  // Capture-to-display latency of every display
+  std::vector<LatencyHistogram*> display_latencies{};
+  std::exception_ptr error{};
+  std::thread thread{};
+
+  // Returns `true` if any frame was shown
+  bool show_new_frames();
+  void run();
+
+ public:
+  // How long to sleep when there is nothing to show
+  static constexpr std::chrono::milliseconds idle_period{1};
+
+  RenderThread(FrameSink& frame_sink, std::deque<DisplaySlot>& display_slots,
+               std::stop_source shared_stop_source,
+               Metrics* metrics = nullptr,
+               const ThreadSettings& thread_settings = {});
+  RenderThread(const RenderThread&) = delete;
+  RenderThread(RenderThread&&) = delete;
+  RenderThread& operator=(const RenderThread&) = delete;
+  RenderThread& operator=(RenderThread&&) = delete;
+
+  // Requests a stop, waits for the thread and rethrows its error.
+  // The sink may be used by the caller afterwards.
+  void join();
+
+  ~RenderThread();
+};
+
+#endif
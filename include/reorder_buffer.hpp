@@ -0,0 +1,74 @@
+// MIT License
+//
+// Copyright (c) 2021-2022 char-lie
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef REORDER_BUFFER_HPP
+#define REORDER_BUFFER_HPP
+
+#include <concepts>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+
+#include "frame.hpp"
+
+// Restores the order of frames processed concurrently.
+// Every sequence number starting from 0 should be completed exactly once,
+// dropped frames are completed with `std::nullopt`.
+class ReorderBuffer {
+  std::mutex mutex{};
+  std::map<std::uint64_t, std::optional<Frame>> pending{};
+  std::uint64_t next_sequence{0U};
+
+ public:
+  ReorderBuffer() = default;
+  ReorderBuffer(const ReorderBuffer&) = delete;
+  ReorderBuffer(ReorderBuffer&&) = delete;
+  ReorderBuffer& operator=(const ReorderBuffer&) = delete;
+  ReorderBuffer& operator=(ReorderBuffer&&) = delete;
+
+  // Calls `release` for every frame that is next in order.
+  // Releases are serialized.
+  template <typename F>
+  requires std::invocable<F, Frame> void complete(std::uint64_t sequence,
+                                                  std::optional<Frame> frame,
+                                                  F release);
+
+  ~ReorderBuffer() = default;
+};
+
+template <typename F>
+requires std::invocable<F, Frame> void ReorderBuffer::complete(
+    const std::uint64_t sequence, std::optional<Frame> frame, F release) {
+  std::lock_guard lock{this->mutex};
+  this->pending.emplace(sequence, std::move(frame));
+  auto next{this->pending.begin()};
+  while (next != this->pending.end() and next->first == this->next_sequence) {
+    if (next->second) {
+      release(std::move(*next->second));
+    }
+    next = this->pending.erase(next);
+    ++this->next_sequence;
+  }
+}
+
+#endif
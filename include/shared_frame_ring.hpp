@@ -0,0 +1,116 @@
+// MIT License
+//
+// Copyright (c) 2021-2022 char-lie
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef SHARED_FRAME_RING_HPP
+#define SHARED_FRAME_RING_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <opencv2/core/mat.hpp>
+#include <optional>
+#include <string>
+
+// POSIX shared memory segment with a ring of the latest frames for other
+// processes of the machine. A header is followed by slots, each with
+// a header holding the sequence number, timestamp, size and type of its
+// frame followed by the pixels, both aligned to
+// `shared_frame_ring_alignment` bytes.
+// Every slot is guarded by a sequence lock: the writer never waits for
+// readers, and readers use the frames in place and check afterwards
+// that the writer has not overwritten them meanwhile.
+// A writer closes its segment when it is done or replaces it,
+// e.g. with larger slots, so readers know to open the name again.
+inline constexpr std::size_t shared_frame_ring_alignment{64U};
+
+// `/PREFIX.WINDOW` with characters other than letters, digits, `.`, `-`
+// and `_` replaced with `_`
+std::string shared_frame_ring_name(const std::string& prefix,
+                                   const std::string& window_name);
+
+class SharedFrameRingWriter {
+  std::string name;
+  void* mapping{nullptr};
+  std::size_t mapping_size{0U};
+  std::uint64_t frame_count{0U};
+
+ public:
+  static constexpr std::size_t default_slot_count{4U};
+
+  // Replaces a segment of the same name left by a previous run.
+  // The slots hold frames of up to `frame_capacity` bytes.
+  SharedFrameRingWriter(std::string segment_name, std::size_t frame_capacity,
+                        std::size_t slot_count = default_slot_count);
+  SharedFrameRingWriter(const SharedFrameRingWriter&) = delete;
+  SharedFrameRingWriter(SharedFrameRingWriter&&) = delete;
+  SharedFrameRingWriter& operator=(const SharedFrameRingWriter&) = delete;
+  SharedFrameRingWriter& operator=(SharedFrameRingWriter&&) = delete;
+
+  // Copies the frame into the oldest slot.
+  // Throws if it does not fit into a slot.
+  void publish(const cv::Mat& frame,
+               std::chrono::steady_clock::time_point capture_time);
+  [[nodiscard]] std::uint64_t frames() const noexcept;
+  // Bytes of the largest frame that fits into a slot
+  [[nodiscard]] std::size_t capacity() const noexcept;
+
+  // Closes and removes the segment, readers keep their mappings
+  ~SharedFrameRingWriter();
+};
+
+class SharedFrameRingReader {
+ public:
+  struct View {
+    // Publication order, starting from 1
+    std::uint64_t sequence{0U};
+    // The steady clock is shared by the processes of a machine
+    std::chrono::steady_clock::time_point capture_time{};
+    // Wraps the mapped pixels without copying.
+    // The mapping is read-only, so the image must not be modified.
+    cv::Mat image{};
+  };
+
+ private:
+  void* mapping{nullptr};
+  std::size_t mapping_size{0U};
+
+ public:
+  explicit SharedFrameRingReader(const std::string& segment_name);
+  SharedFrameRingReader(const SharedFrameRingReader&) = delete;
+  SharedFrameRingReader(SharedFrameRingReader&&) = delete;
+  SharedFrameRingReader& operator=(const SharedFrameRingReader&) = delete;
+  SharedFrameRingReader& operator=(SharedFrameRingReader&&) = delete;
+
+  // The latest frame if it is newer than the `after` sequence number.
+  // The writer reuses its slot after the next `slot_count - 1` frames,
+  // so check `is_intact` after using the pixels.
+  [[nodiscard]] std::optional<View> latest(std::uint64_t after = 0U) const;
+  // Whether the pixels of the view have not been overwritten yet
+  [[nodiscard]] bool is_intact(const View& view) const noexcept;
+  // Whether the writer has closed the segment: no frames follow,
+  // and the name no longer opens it but a segment of a new writer
+  [[nodiscard]] bool is_closed() const noexcept;
+
+  ~SharedFrameRingReader();
+};
+
+#endif
@@ -0,0 +1,103 @@
+// MIT License
+//
+// Copyright (c) 2021-2022 char-lie
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef STAGE_HPP
+#define STAGE_HPP
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+
+#include "frame.hpp"
+
+class Executor;
+
+class Stage {
+ public:
+  Stage() = default;
+  Stage(const Stage&) = delete;
+  Stage(Stage&&) noexcept = default;
+  Stage& operator=(const Stage&) = delete;
+  Stage& operator=(Stage&&) noexcept = default;
+
+  // Returns the frame for the consumers of the stage output
+  // or `std::nullopt` to drop it
+  virtual std::optional<Frame> process(Frame frame) = 0;
+
+  virtual ~Stage() = default;
+};
+
+// Coroutine processing a frame for a `CoroutineStage`.
+// It starts when awaited, resumes the awaiting coroutine when it returns
+// and rethrows its exception there.
+class StageTask {
+ public:
+  struct promise_type;
+  using Handle = std::coroutine_handle<promise_type>;
+
+  struct FinalAwaiter {
+    [[nodiscard]] bool await_ready() const noexcept;
+    std::coroutine_handle<> await_suspend(Handle handle) const noexcept;
+    void await_resume() const noexcept;
+  };
+
+  struct promise_type {
+    std::optional<Frame> output{};
+    std::exception_ptr exception{};
+    std::coroutine_handle<> continuation{};
+
+    StageTask get_return_object() noexcept;
+    [[nodiscard]] std::suspend_always initial_suspend() const noexcept;
+    [[nodiscard]] FinalAwaiter final_suspend() const noexcept;
+    void return_value(std::optional<Frame> frame);
+    void unhandled_exception() noexcept;
+  };
+
+ private:
+  Handle handle;
+
+  explicit StageTask(Handle coroutine) noexcept;
+
+ public:
+  StageTask(const StageTask&) = delete;
+  StageTask(StageTask&& other) noexcept;
+  StageTask& operator=(const StageTask&) = delete;
+  StageTask& operator=(StageTask&& other) noexcept;
+
+  [[nodiscard]] bool await_ready() const noexcept;
+  std::coroutine_handle<> await_suspend(
+      std::coroutine_handle<> awaiting) const noexcept;
+  std::optional<Frame> await_resume() const;
+
+  ~StageTask();
+};
+
+// Stage that may suspend while it processes a frame, e.g. on the timers
+// of an executor. A pipeline running on an executor awaits
+// `process_async`, the other pipelines call `process`, which never waits.
+class CoroutineStage : public Stage {
+ public:
+  // Same result as `process`, but may `co_await` the `executor`
+  virtual StageTask process_async(Frame frame, Executor& executor) = 0;
+};
+
+#endif
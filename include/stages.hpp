@@ -0,0 +1,238 @@
+// MIT License
+//
+// Copyright (c) 2021-2022 char-lie
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef STAGES_HPP
+#define STAGES_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <opencv2/core/mat.hpp>
+#include <optional>
+#include <string>
+
+#include "average_intensity_calculator.hpp"
+#include "display_slot.hpp"
+#include "frame.hpp"
+#include "frame_pool.hpp"
+#include "frame_store.hpp"
+#include "intensity_window.hpp"
+#include "metrics.hpp"
+#include "rate_controller.hpp"
+#include "stage.hpp"
+
+// Passes every `period`-th frame
+class DecimateStage : public Stage {
+  std::size_t period;
+  std::size_t frame_number{0U};
+
+ public:
+  explicit DecimateStage(std::size_t decimation_period);
+
+  std::optional<Frame> process(Frame frame) override;
+};
+
+// Passes at most one frame per `period` of capture time,
+// without reading the clock.
+// On an executor it sleeps until the end of the period after dropping
+// a frame, so the frames it would drop replace each other in its queue
+// instead of waking it one by one.
+class ThrottleStage : public CoroutineStage {
+  std::chrono::steady_clock::duration period;
+  std::optional<std::chrono::steady_clock::time_point> previous_frame_time{};
+
+ public:
+  explicit ThrottleStage(std::chrono::steady_clock::duration throttle_period);
+
+  std::optional<Frame> process(Frame frame) override;
+  StageTask process_async(Frame frame, Executor& executor) override;
+};
+
+// Passes the frames admitted by the rate `controller` of the consumer
+class AdaptiveRateStage : public Stage {
+  RateController& controller;
+
+ public:
+  explicit AdaptiveRateStage(RateController& rate_controller);
+
+  std::optional<Frame> process(Frame frame) override;
+};
+
+// Runs the `stage` and reports its service time to the rate `controller`.
+// It is as thread-safe as the `stage`.
+class RateMeteredStage : public Stage {
+  std::unique_ptr<Stage> stage;
+  RateController& controller;
+
+ public:
+  RateMeteredStage(std::unique_ptr<Stage> metered_stage,
+                   RateController& rate_controller);
+
+  std::optional<Frame> process(Frame frame) override;
+};
+
+// Compares every frame with the last changed one, by the blocks of their
+// signatures, and sets its `Frame::content_index` to the index of that
+// frame if no block differs by more than `threshold` levels, counting it
+// as `unchanged`. Comparing with the last changed frame rather than
+// the previous one keeps slow fades from drifting unnoticed.
+// Compressed frames are compared before their full decode, by a decode
+// at 1/8 resolution: it still entropy-decodes every coefficient but skips
+// the full-resolution IDCT and colour conversion.
+class ChangeDetectStage : public Stage {
+  double threshold;
+  bool is_compressed;
+  Counter* unchanged;
+  cv::Mat reduced{};
+  cv::Mat signature{};
+  cv::Mat reference_signature{};
+  std::uint64_t reference_index{0U};
+
+ public:
+  ChangeDetectStage(double max_difference, bool compressed_frames,
+                    Counter* unchanged_frames = nullptr);
+  ChangeDetectStage(const ChangeDetectStage&) = delete;
+  ChangeDetectStage(ChangeDetectStage&&) = delete;
+  ChangeDetectStage& operator=(const ChangeDetectStage&) = delete;
+  ChangeDetectStage& operator=(ChangeDetectStage&&) = delete;
+  ~ChangeDetectStage() override = default;
+
+  std::optional<Frame> process(Frame frame) override;
+};
+
+// Runs the `stage` unless the frame has the `Frame::content_index` of the
+// last frame it ran for, and passes its last output on with the index and
+// capture time of the frame otherwise, counting it as `reused`.
+// Outputs are not reused across `index_period` frame indices (0 for never),
+// for stages whose output also depends on the index, like the rotation.
+// It is as thread-safe as the `stage`: a frame whose content is still
+// processed by another worker is processed again.
+class ContentReuseStage : public Stage {
+  std::unique_ptr<Stage> stage;
+  std::uint64_t index_period;
+  Counter* reused;
+  std::mutex mutex{};
+  std::optional<Frame> output{};
+  std::uint64_t output_content_index{0U};
+  std::uint64_t output_period{0U};
+
+ public:
+  ContentReuseStage(std::unique_ptr<Stage> reused_stage,
+                    std::uint64_t output_index_period,
+                    Counter* reused_frames = nullptr);
+  ContentReuseStage(const ContentReuseStage&) = delete;
+  ContentReuseStage(ContentReuseStage&&) = delete;
+  ContentReuseStage& operator=(const ContentReuseStage&) = delete;
+  ContentReuseStage& operator=(ContentReuseStage&&) = delete;
+  ~ContentReuseStage() override = default;
+
+  std::optional<Frame> process(Frame frame) override;
+};
+
+// Converts frames to grayscale and rotates them by a quarter turn
+// every `rotation_period` captured frames.
+// The rotation depends only on the frame index, so frames can be processed
+// concurrently. A frame is split into `bands` processed in parallel.
+class GrayRotateStage : public Stage {
+  FramePool& frame_pool;
+  std::size_t rotation_period;
+  int bands;
+
+ public:
+  GrayRotateStage(FramePool& pool, std::size_t frames_per_rotation,
+                  int frame_bands = 1);
+
+  std::optional<Frame> process(Frame frame) override;
+};
+
+// Flips frames whose average intensity exceeds half of the `threshold`.
+// With a `window_length` above 1 the intensity is averaged over that many
+// last frames instead.
+// With `metrics` it reports the `intensity` and `flip` durations
+// and the escalations of sampled intensity estimates,
+// named with the `metrics_prefix`.
+// Frames are flipped in `bands` processed in parallel.
+class IntensityFlipStage : public Stage {
+  AverageIntensityCalculator average_intensity_calculator;
+  std::optional<IntensityWindow> intensity_window{};
+  std::size_t threshold;
+  FramePool& frame_pool;
+  int bands;
+  LatencyHistogram* intensity_time{nullptr};
+  LatencyHistogram* flip_time{nullptr};
+  Counter* escalations{nullptr};
+
+ public:
+  IntensityFlipStage(AverageIntensityCalculator calculator,
+                     std::size_t intensity_threshold, FramePool& pool,
+                     std::size_t window_length = 1U,
+                     Metrics* metrics = nullptr,
+                     const std::string& metrics_prefix = {},
+                     int frame_bands = 1);
+  IntensityFlipStage(const IntensityFlipStage&) = delete;
+  IntensityFlipStage(IntensityFlipStage&&) = delete;
+  IntensityFlipStage& operator=(const IntensityFlipStage&) = delete;
+  IntensityFlipStage& operator=(IntensityFlipStage&&) = delete;
+  ~IntensityFlipStage() override = default;
+
+  std::optional<Frame> process(Frame frame) override;
+};
+
+// Publishes frames to be shown by another thread
+class DisplayStage : public Stage {
+  DisplaySlot& display_slot;
+
+ public:
+  explicit DisplayStage(DisplaySlot& slot);
+
+  std::optional<Frame> process(Frame frame) override;
+};
+
+// Decodes the frames of a compressed source into pooled buffers.
+// A `scale` of 2, 4 or 8 decodes JPEG images at that fraction of their
+// resolution, which skips most of the inverse DCT.
+// Frames that cannot be decoded are dropped.
+// Stateless, so it can have several workers.
+class DecodeStage : public Stage {
+  FramePool& frame_pool;
+  int flags;
+
+ public:
+  explicit DecodeStage(FramePool& pool, int scale = 1);
+
+  std::optional<Frame> process(Frame frame) override;
+};
+
+// Appends frames to a `FrameStoreWriter` recording on its own stage thread,
+// so disk writes stay off the capture path
+class RecordStage : public Stage {
+  FrameStoreWriter writer;
+
+ public:
+  explicit RecordStage(const std::string& path);
+
+  std::optional<Frame> process(Frame frame) override;
+};
+
+#endif
@@ -20,23 +20,25 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
-#ifndef QUEUE_THREAD_HPP
-#define QUEUE_THREAD_HPP
+#ifndef THREAD_SETTINGS_HPP
+#define THREAD_SETTINGS_HPP
 
-#include <cstddef>
-#include <opencv2/core/mat.hpp>
+#include <optional>
+#include <thread>
+#include <vector>
 
-#include "circular_buffer.hpp"
-#include "thread_handle.hpp"
+struct ThreadSettings {
+  // CPUs the thread may run on, any if empty.
+  // Frames are allocated on the NUMA node of the thread that touches them
+  // first, so pinning a capture thread places its buffers.
+  std::vector<int> cpus{};
+  // `SCHED_FIFO` priority, the default scheduling if not set
+  std::optional<int> realtime_priority{};
+};
 
-template <std::size_t buffer_size>
-void queue_thread(ThreadHandle &thread_handle,
-                  CircularBuffer<cv::Mat, buffer_size> &frames_queue);
-
-template <std::size_t buffer_size>
-void process_t1(ThreadHandle &queue_thread_handle, cv::Mat &image,
-                CircularBuffer<cv::Mat, buffer_size> &frames_queue);
-
-#include "queue_thread.tpp"
+// Throws if the system refuses, e.g. without the privilege for
+// a real-time priority
+void apply_thread_settings(std::thread& thread,
+                           const ThreadSettings& settings);
 
 #endif
@@ -0,0 +1,90 @@
+// MIT License
+//
+// Copyright (c) 2021-2022 char-lie
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef WORKER_POOL_HPP
+#define WORKER_POOL_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "thread_settings.hpp"
+
+// Fixed set of threads running the tasks of several lanes.
+// Lanes with pending tasks are served round-robin, one task per turn,
+// so a lane with a long backlog cannot starve the others.
+class WorkerPool {
+ public:
+  // Tasks of one client, e.g. of one stream. Tasks should not throw.
+  class Lane {
+    friend class WorkerPool;
+
+    WorkerPool& pool;
+    // Guarded by the mutex of the pool
+    std::deque<std::function<void()>> tasks{};
+    std::size_t running_tasks{0U};
+
+   public:
+    explicit Lane(WorkerPool& worker_pool);
+    Lane(const Lane&) = delete;
+    Lane(Lane&&) = delete;
+    Lane& operator=(const Lane&) = delete;
+    Lane& operator=(Lane&&) = delete;
+
+    void post(std::function<void()> task);
+    // Waits until the lane has no queued or running tasks
+    void wait_idle();
+
+    ~Lane();
+  };
+
+ private:
+  std::mutex mutex{};
+  std::condition_variable work_available{};
+  std::condition_variable lane_idle{};
+  // Lanes with queued tasks in the order of their turns
+  std::deque<Lane*> ready_lanes{};
+  bool is_finished{false};
+  std::vector<std::thread> threads{};
+
+  void run();
+  void finish();
+
+ public:
+  explicit WorkerPool(std::size_t thread_count,
+                      const ThreadSettings& thread_settings = {});
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool(WorkerPool&&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+  WorkerPool& operator=(WorkerPool&&) = delete;
+
+  [[nodiscard]] std::size_t size() const noexcept;
+
+  // Lanes should be destroyed first
+  ~WorkerPool();
+};
+
+#endif
@@ -22,13 +22,202 @@
 
 #include "average_intensity_calculator.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <numeric>
+#include <opencv2/core/hal/intrin.hpp>
+#include <opencv2/core/utility.hpp>
 #include <opencv2/imgproc.hpp>
+#include <span>
+#include <stdexcept>
 #include <vector>
 
-void AverageIntensityCalculator::replace_image(const cv::Mat& image) {
-  cv::cvtColor(image, this->images[0], cv::COLOR_RGB2GRAY);
-  if (this->images[0].type() != CV_8U or this->images[0].channels() != 1) {
+#include "frame_bands.hpp"
+#include "gray_conversion.hpp"
+
+namespace {
+
+constexpr int color_channels{3};
+
+struct ChannelSums {
+  std::uint64_t first{0U};
+  std::uint64_t second{0U};
+  std::uint64_t third{0U};
+};
+
+#if CV_SIMD
+// Sum of all lanes of `values` in at most 4 values per 32-bit lane
+cv::v_uint32 widen_sum(const cv::v_uint8& values) {
+  cv::v_uint16 low{};
+  cv::v_uint16 high{};
+  cv::v_expand(values, low, high);
+  cv::v_uint32 low_sum{};
+  cv::v_uint32 high_sum{};
+  cv::v_expand(low + high, low_sum, high_sum);
+  return low_sum + high_sum;
+}
+
+// Returns the number of processed pixels
+int add_row_simd(const uchar* row, const int width, ChannelSums& sums) {
+  static constexpr int lanes{CV_SIMD_WIDTH};
+  // Each 32-bit lane gets at most 4 pixel values per iteration
+  static constexpr int max_iterations{
+      static_cast<int>(std::numeric_limits<std::uint32_t>::max() /
+                       (4U * std::numeric_limits<uchar>::max()))};
+
+  int column{0};
+  while (column <= width - lanes) {
+    cv::v_uint32 first_sum{cv::vx_setzero_u32()};
+    cv::v_uint32 second_sum{cv::vx_setzero_u32()};
+    cv::v_uint32 third_sum{cv::vx_setzero_u32()};
+    for (int iteration{0};
+         iteration < max_iterations and column <= width - lanes;
+         ++iteration, column += lanes) {
+      cv::v_uint8 first{};
+      cv::v_uint8 second{};
+      cv::v_uint8 third{};
+      cv::v_load_deinterleave(row + column * color_channels, first, second,
+                              third);
+      first_sum += widen_sum(first);
+      second_sum += widen_sum(second);
+      third_sum += widen_sum(third);
+    }
+    sums.first += cv::v_reduce_sum(first_sum);
+    sums.second += cv::v_reduce_sum(second_sum);
+    sums.third += cv::v_reduce_sum(third_sum);
+  }
+  return column;
+}
+#endif
+
+void add_row_scalar(const uchar* row, const int begin, const int width,
+                    ChannelSums& sums) {
+  for (const uchar* pixel{row + begin * color_channels};
+       pixel != row + width * color_channels; pixel += color_channels) {
+    sums.first += pixel[0];
+    sums.second += pixel[1];
+    sums.third += pixel[2];
+  }
+}
+
+// Continuous images are processed as a single row
+template <typename F>
+requires std::invocable<F, const uchar*, int> void for_each_row(
+    const cv::Mat& image, F row_function) {
+  if (image.isContinuous()) {
+    row_function(image.ptr<uchar>(0), image.rows * image.cols);
+    return;
+  }
+  for (int row{0}; row < image.rows; ++row) {
+    row_function(image.ptr<uchar>(row), image.cols);
+  }
+}
+
+ChannelSums channel_sums(const cv::Mat& image, const bool use_simd) {
+  ChannelSums sums{};
+  for_each_row(image, [&sums, use_simd](const uchar* row, const int width) {
+    int column{0};
+#if CV_SIMD
+    if (use_simd) {
+      column = add_row_simd(row, width, sums);
+    }
+#else
+    static_cast<void>(use_simd);
+#endif
+    add_row_scalar(row, column, width, sums);
+  });
+#if CV_SIMD
+  cv::vx_cleanup();
+#endif
+  return sums;
+}
+
+// Bands of rows are summed in parallel and their partial sums are added up
+float fused_average(const cv::Mat& image, const bool use_simd,
+                    const int requested_bands = 1) {
+  const int bands{band_count(requested_bands, image.rows)};
+  ChannelSums sums{};
+  if (bands == 1) {
+    sums = channel_sums(image, use_simd);
+  } else {
+    std::vector<ChannelSums> band_sums(static_cast<std::size_t>(bands));
+    cv::parallel_for_(cv::Range{0, bands}, [&](const cv::Range& range) {
+      for (int band{range.start}; band < range.end; ++band) {
+        band_sums[static_cast<std::size_t>(band)] = channel_sums(
+            image.rowRange(band_rows(band, bands, image.rows)), use_simd);
+      }
+    });
+    for (const ChannelSums& band_sum : band_sums) {
+      sums.first += band_sum.first;
+      sums.second += band_sum.second;
+      sums.third += band_sum.third;
+    }
+  }
+
+  const double weighted_sum{
+      static_cast<double>(gray_first_weight) *
+          static_cast<double>(sums.first) +
+      static_cast<double>(gray_second_weight) *
+          static_cast<double>(sums.second) +
+      static_cast<double>(gray_third_weight) *
+          static_cast<double>(sums.third)};
+  return static_cast<float>(weighted_sum /
+                            static_cast<double>(1 << gray_shift) /
+                            static_cast<double>(image.total()));
+}
+
+float exact_average(const cv::Mat& image) {
+  std::uint64_t sum{0U};
+  for_each_row(image, [&sum](const uchar* row, const int width) {
+    for (const uchar* pixel{row}; pixel != row + width * color_channels;
+         pixel += color_channels) {
+      sum += rgb_to_gray(pixel[0], pixel[1], pixel[2]);
+    }
+  });
+  return static_cast<float>(static_cast<double>(sum) /
+                            static_cast<double>(image.total()));
+}
+
+AverageIntensityCalculator::Estimate sampled_average(
+    const cv::Mat& image, const IntensitySampling sampling) {
+  // Shifts the columns of consecutive sampled rows,
+  // so patterns with the period of `stride` are not aliased.
+  // The first row starts at 0, so any non-empty frame has a sample.
+  static constexpr int phase_step{3};
+
+  const int stride{sampling.stride};
+  std::uint64_t sum{0U};
+  std::uint64_t squares_sum{0U};
+  std::uint64_t count{0U};
+  for (int row{0}; row < image.rows; row += stride) {
+    const uchar* const pixels{image.ptr<uchar>(row)};
+    for (int column{row / stride * phase_step % stride}; column < image.cols;
+         column += stride) {
+      const uchar* const pixel{pixels + column * color_channels};
+      const std::uint64_t gray{rgb_to_gray(pixel[0], pixel[1], pixel[2])};
+      sum += gray;
+      squares_sum += gray * gray;
+      ++count;
+    }
+  }
+
+  const auto samples{static_cast<double>(count)};
+  const double mean{static_cast<double>(sum) / samples};
+  const double variance{
+      std::max(static_cast<double>(squares_sum) / samples - mean * mean, 0.0)};
+  return {static_cast<float>(mean),
+          sampling.confidence_sigmas *
+              static_cast<float>(std::sqrt(variance / samples))};
+}
+
+void convert_to_gray(const cv::Mat& image, cv::Mat& gray) {
+  cv::cvtColor(image, gray, cv::COLOR_RGB2GRAY);
+  if (gray.type() != CV_8U or gray.channels() != 1) {
     throw std::runtime_error{
         "Something is wrong with `cv::cvtColor` function: `cv::COLOR_RGB2GRAY` "
         "conversion is expected to create a grayscale image with [0; 255] "
@@ -36,7 +225,7 @@ void AverageIntensityCalculator::replace_image(const cv::Mat& image) {
   }
 }
 
-float AverageIntensityCalculator::average() {
+float histogram_average(const cv::Mat& gray, cv::Mat& histogram) {
   static constexpr int min_intensity{0};
   static constexpr int max_intensity{255};
   static constexpr int histogram_bars{max_intensity + 1};
@@ -44,22 +233,22 @@ float AverageIntensityCalculator::average() {
   static_assert(std::numeric_limits<uchar>::max() == max_intensity);
   static_assert(std::numeric_limits<uchar>::min() == min_intensity);
 
-  if (this->images[0].type() != CV_8U or this->images[0].channels() != 1 or
-      this->images[0].empty()) {
+  if (gray.type() != CV_8U or gray.channels() != 1 or gray.empty()) {
     throw std::runtime_error{
         "Only non-empty grayscale images with [0; 255] intensity range are "
         "allowed."};
   }
 
-  static const std::vector<int> channels{};
+  static constexpr int channel{0};
+  static constexpr int histogram_size{histogram_bars};
+  static constexpr std::array<float, 2> histogram_range{min_intensity,
+                                                        histogram_bars};
   static const cv::Mat mask{};
-  static const std::vector<int> histogram_size{histogram_bars};
-  static const std::vector<float> histogram_range{min_intensity,
-                                                  histogram_bars};
+  std::array<const float*, 1> ranges{histogram_range.data()};
 
-  cv::calcHist(this->images, channels, mask, this->histogram, histogram_size,
-               histogram_range);
-  this->histogram /= this->images[0].cols * this->images[0].rows;
+  cv::calcHist(&gray, 1, &channel, mask, histogram, 1, &histogram_size,
+               ranges.data());
+  histogram /= gray.cols * gray.rows;
 
   float current_intensity{0.0F};
   float average_color{std::accumulate(
@@ -70,3 +259,129 @@ float AverageIntensityCalculator::average() {
 
   return average_color;
 }
+
+}  // namespace
+
+AverageIntensityCalculator::AverageIntensityCalculator(
+    const Method calculation_method, const IntensitySampling sampling_settings,
+    const int parallel_bands)
+    : method{calculation_method},
+      sampling{sampling_settings},
+      bands{parallel_bands} {
+  if (this->sampling.stride <= 0) {
+    throw std::runtime_error{"Sampling stride should be positive"};
+  }
+  if (this->bands <= 0) {
+    throw std::runtime_error{"There should be at least one band"};
+  }
+}
+
+void AverageIntensityCalculator::replace_image(const cv::Mat& image) {
+  if (this->method != Method::histogram) {
+    if (image.type() != CV_8UC3) {
+      throw std::runtime_error{
+          "Only 3-channel images with [0; 255] intensity range are allowed."};
+    }
+    this->frame = image;
+    return;
+  }
+
+  convert_to_gray(image, this->gray_frame);
+}
+
+float AverageIntensityCalculator::average() {
+  if (this->method == Method::histogram) {
+    return histogram_average(this->gray_frame, this->histogram);
+  }
+
+  if (this->frame.empty()) {
+    throw std::runtime_error{"Only non-empty images are allowed."};
+  }
+  switch (this->method) {
+    case Method::sampled:
+      return sampled_average(this->frame, this->sampling).average;
+    case Method::fused:
+      return fused_average(this->frame, true, this->bands);
+    case Method::fused_scalar:
+      return fused_average(this->frame, false, this->bands);
+    case Method::exact:
+    default:
+      return exact_average(this->frame);
+  }
+}
+
+AverageIntensityCalculator::Estimate AverageIntensityCalculator::estimate() {
+  if (this->method != Method::sampled) {
+    return {this->average(), 0.0F};
+  }
+  if (this->frame.empty()) {
+    throw std::runtime_error{"Only non-empty images are allowed."};
+  }
+  return sampled_average(this->frame, this->sampling);
+}
+
+bool AverageIntensityCalculator::exceeds(const float limit) {
+  const Estimate sampled{this->estimate()};
+  if (this->method != Method::sampled or
+      std::abs(sampled.average - limit) > sampled.margin) {
+    return sampled.average > limit;
+  }
+  ++this->escalation_count;
+  return fused_average(this->frame, true, this->bands) > limit;
+}
+
+std::size_t AverageIntensityCalculator::escalations() const noexcept {
+  return this->escalation_count;
+}
+
+void AverageIntensityCalculator::average_batch(
+    const std::span<const cv::Mat> batch, const std::span<float> averages) {
+  if (averages.size() != batch.size()) {
+    throw std::runtime_error{"There should be an average for every image."};
+  }
+  if (batch.size() >
+      static_cast<std::size_t>(std::numeric_limits<int>::max())) {
+    throw std::runtime_error{"The batch is too large."};
+  }
+  // Validated upfront, so the parallel loop does not throw
+  for (const cv::Mat& image : batch) {
+    if (image.type() != CV_8UC3 or image.empty()) {
+      throw std::runtime_error{
+          "Only non-empty 3-channel images with [0; 255] intensity range are "
+          "allowed."};
+    }
+  }
+  if (this->method == Method::histogram and
+      this->batch_images.size() < batch.size()) {
+    this->batch_images.resize(batch.size());
+    this->batch_histograms.resize(batch.size());
+  }
+
+  cv::parallel_for_(cv::Range{0, static_cast<int>(batch.size())},
+                    [this, batch, averages](const cv::Range& range) {
+                      for (int i{range.start}; i < range.end; ++i) {
+                        const auto index{static_cast<std::size_t>(i)};
+                        averages[index] =
+                            this->batch_average(batch[index], index);
+                      }
+                    });
+}
+
+float AverageIntensityCalculator::batch_average(
+    const cv::Mat& image, const std::size_t scratch_index) {
+  switch (this->method) {
+    case Method::histogram:
+      convert_to_gray(image, this->batch_images[scratch_index]);
+      return histogram_average(this->batch_images[scratch_index],
+                               this->batch_histograms[scratch_index]);
+    case Method::sampled:
+      return sampled_average(image, this->sampling).average;
+    case Method::fused:
+      return fused_average(image, true);
+    case Method::fused_scalar:
+      return fused_average(image, false);
+    case Method::exact:
+    default:
+      return exact_average(image);
+  }
+}
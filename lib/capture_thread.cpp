@@ -0,0 +1,131 @@
+// MIT License
+//
+// Copyright (c) 2021-2022 char-lie
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "capture_thread.hpp"
+
+#include <chrono>
+#include <exception>
+#include <opencv2/core/mat.hpp>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "frame_pool.hpp"
+#include "frame_source.hpp"
+#include "metrics.hpp"
+#include "pipeline.hpp"
+#include "thread_settings.hpp"
+
+CaptureThread::CaptureThread(FrameSource& frame_source,
+                             Pipeline& frame_pipeline, std::string stream_name,
+                             FramePool& pool, Settings capture_settings,
+                             std::stop_source shared_stop_source,
+                             Metrics* metrics)
+    : source{frame_source},
+      pipeline{frame_pipeline},
+      stream{std::move(stream_name)},
+      frame_pool{pool},
+      settings{std::move(capture_settings)},
+      stop_source{std::move(shared_stop_source)} {
+  if (metrics != nullptr) {
+    this->read_time = &metrics->histogram(this->stream);
+  }
+  this->thread = std::thread{&CaptureThread::run, this};
+  try {
+    apply_thread_settings(this->thread, this->settings.thread_settings);
+  } catch (...) {
+    this->stop_source.request_stop();
+    this->thread.join();
+    throw;
+  }
+}
+
+bool CaptureThread::is_over() const {
+  return (this->settings.frame_limit and
+          this->frame_count >= *this->settings.frame_limit) or
+         (this->settings.duration_limit and
+          std::chrono::steady_clock::now() - this->start_time >=
+              *this->settings.duration_limit);
+}
+
+void CaptureThread::run() {
+  const std::stop_token stop_token{this->stop_source.get_token()};
+  this->start_time = std::chrono::steady_clock::now();
+  // The pool keeps buffers by geometry, which compressed packets change
+  // with every frame: they would only fill it with unmatched buffers
+  const bool is_pooled{!this->source.is_compressed()};
+  try {
+    while (!stop_token.stop_requested() and !this->is_over()) {
+      // Stages share the frame, so every frame gets its own buffer
+      cv::Mat image;
+      if (is_pooled) {
+        image.allocator = &this->frame_pool;
+      }
+      const auto read_start_time{std::chrono::steady_clock::now()};
+      if (!this->source.read(image)) {
+        break;
+      }
+      const auto read_end_time{std::chrono::steady_clock::now()};
+      if (this->read_time != nullptr) {
+        this->read_time->record(read_end_time - read_start_time);
+      }
+      if (this->frame_count == 0U and is_pooled) {
+        this->frame_pool.reserve(image.size(), image.type(),
+                                 this->settings.preallocated_frames);
+      }
+      this->pipeline.push(this->stream,
+                          {std::move(image), ++this->frame_count,
+                           read_end_time});
+    }
+  } catch (...) {
+    this->error = std::current_exception();
+  }
+  this->end_time = std::chrono::steady_clock::now();
+  this->stop_source.request_stop();
+}
+
+void CaptureThread::join() {
+  this->stop_source.request_stop();
+  if (this->thread.joinable()) {
+    this->thread.join();
+  }
+  if (this->error) {
+    std::rethrow_exception(std::exchange(this->error, nullptr));
+  }
+}
+
+std::uint64_t CaptureThread::frames() const noexcept {
+  return this->frame_count;
+}
+
+std::chrono::duration<double> CaptureThread::elapsed() const noexcept {
+  return this->end_time - this->start_time;
+}
+
+CaptureThread::~CaptureThread() {
+  try {
+    this->join();
+  } catch (...) {
+    // Call `join` explicitly to handle capture errors
+  }
+}
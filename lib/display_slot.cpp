@@ -0,0 +1,63 @@
+// MIT License
+//
+// Copyright (c) 2021-2022 char-lie
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "display_slot.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "frame.hpp"
+
+DisplaySlot::DisplaySlot(std::string cv_window_name)
+    : window_name{std::move(cv_window_name)} {}
+
+void DisplaySlot::publish(Frame new_frame) {
+  Buffer& buffer{this->buffers[this->back]};
+  buffer.frame = std::move(new_frame);
+  buffer.sequence = ++this->published;
+  // Releases the frame to the consumer and acquires the buffer it left
+  this->back = this->middle.exchange(this->back | fresh_flag,
+                                     std::memory_order_acq_rel) &
+               index_mask;
+}
+
+std::optional<Frame> DisplaySlot::take() {
+  if ((this->middle.load(std::memory_order_relaxed) & fresh_flag) == 0U) {
+    return std::nullopt;
+  }
+  // Only the consumer clears the flag, so the middle buffer is still fresh
+  this->front =
+      this->middle.exchange(this->front, std::memory_order_acq_rel) &
+      index_mask;
+  Buffer& buffer{this->buffers[this->front]};
+  this->skipped_count.fetch_add(buffer.sequence - this->taken_sequence - 1U,
+                                std::memory_order_relaxed);
+  this->taken_sequence = buffer.sequence;
+  return std::move(buffer.frame);
+}
+
+std::uint64_t DisplaySlot::skipped() const noexcept {
+  return this->skipped_count.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,324 @@
+// MIT License
+//
+// Copyright (c) 2021-2022 char-lie
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "executor.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include "thread_settings.hpp"
+
+namespace {
+
+// Executor and worker of the calling thread
+thread_local const Executor* current_executor{nullptr};
+thread_local std::size_t current_worker{0U};
+
+constexpr auto no_timer{std::numeric_limits<Executor::Clock::rep>::max()};
+
+}  // namespace
+
+Executor::Group::Group(Executor& group_executor) : executor{group_executor} {}
+
+void Executor::Group::spawn(Task task) {
+  {
+    std::lock_guard lock{this->mutex};
+    ++this->running_tasks;
+  }
+  task.handle.promise().group = this;
+  this->executor.schedule(std::exchange(task.handle, nullptr));
+}
+
+void Executor::Group::finish_task() {
+  std::lock_guard lock{this->mutex};
+  --this->running_tasks;
+  // Under the lock: the group may be destroyed right after `wait`
+  this->finished.notify_all();
+}
+
+void Executor::Group::wait() {
+  std::unique_lock lock{this->mutex};
+  this->finished.wait(lock, [this] { return this->running_tasks == 0U; });
+}
+
+Executor::Group::~Group() { this->wait(); }
+
+Executor::SleepAwaiter::SleepAwaiter(Executor& sleep_executor,
+                                     const Clock::time_point resume_time)
+    : executor{sleep_executor}, time{resume_time} {}
+
+bool Executor::SleepAwaiter::await_ready() const noexcept {
+  return this->time <= Clock::now();
+}
+
+void Executor::SleepAwaiter::await_suspend(
+    const std::coroutine_handle<> handle) const {
+  bool is_earliest{false};
+  {
+    std::lock_guard lock{this->executor.mutex};
+    this->executor.timers.push({this->time, handle});
+    const Clock::rep ticks{this->time.time_since_epoch().count()};
+    is_earliest = ticks < this->executor.next_timer.load();
+    if (is_earliest) {
+      this->executor.next_timer.store(ticks);
+    }
+  }
+  if (is_earliest) {
+    // A sleeping thread waits for the previous deadline
+    this->executor.work_available.notify_one();
+  }
+}
+
+void Executor::SleepAwaiter::await_resume() const noexcept {}
+
+Executor::YieldAwaiter::YieldAwaiter(Executor& yield_executor)
+    : executor{yield_executor} {}
+
+bool Executor::YieldAwaiter::await_ready() const noexcept {
+  return this->executor.ready_count.load() == 0U;
+}
+
+void Executor::YieldAwaiter::await_suspend(
+    const std::coroutine_handle<> handle) const {
+  this->executor.schedule(handle);
+}
+
+void Executor::YieldAwaiter::await_resume() const noexcept {}
+
+bool Executor::Timer::operator>(const Timer& other) const noexcept {
+  return this->time > other.time;
+}
+
+Executor::Executor(const std::size_t thread_count,
+                   const ThreadSettings& thread_settings)
+    : next_timer{no_timer} {
+  if (thread_count == 0U) {
+    throw std::runtime_error{"Executor should have at least one thread"};
+  }
+  for (std::size_t i{0U}; i < thread_count; ++i) {
+    this->workers.push_back(std::make_unique<Worker>());
+  }
+  this->threads.reserve(thread_count);
+  try {
+    for (std::size_t i{0U}; i < thread_count; ++i) {
+      this->threads.emplace_back(&Executor::run, this, i);
+      apply_thread_settings(this->threads.back(), thread_settings);
+    }
+  } catch (...) {
+    this->finish();
+    throw;
+  }
+}
+
+void Executor::schedule(const std::coroutine_handle<> handle) {
+  const std::size_t worker_index{
+      current_executor == this
+          ? current_worker
+          : this->next_worker.fetch_add(1U, std::memory_order_relaxed) %
+                this->workers.size()};
+  {
+    Worker& worker{*this->workers[worker_index]};
+    std::lock_guard lock{worker.mutex};
+    worker.ready.push_back(handle);
+  }
+  // Pairs with the check of a thread going to sleep: either it sees the
+  // coroutine or it is seen sleeping
+  this->ready_count.fetch_add(1U);
+  if (this->sleeping_threads.load() > 0U) {
+    std::lock_guard lock{this->mutex};
+    this->work_available.notify_one();
+  }
+}
+
+Executor::SleepAwaiter Executor::sleep_until(const Clock::time_point time) {
+  return SleepAwaiter{*this, time};
+}
+
+Executor::SleepAwaiter Executor::sleep_for(const Clock::duration duration) {
+  return SleepAwaiter{*this, Clock::now() + duration};
+}
+
+Executor::YieldAwaiter Executor::yield() { return YieldAwaiter{*this}; }
+
+std::size_t Executor::size() const noexcept { return this->threads.size(); }
+
+std::uint64_t Executor::steals() const noexcept {
+  return this->steal_count.load(std::memory_order_relaxed);
+}
+
+std::coroutine_handle<> Executor::take(const std::size_t worker_index) {
+  if (this->ready_count.load() == 0U) {
+    return nullptr;
+  }
+  for (std::size_t i{0U}; i < this->workers.size(); ++i) {
+    const bool is_own{i == 0U};
+    Worker& worker{
+        *this->workers[(worker_index + i) % this->workers.size()]};
+    std::lock_guard lock{worker.mutex};
+    if (worker.ready.empty()) {
+      continue;
+    }
+    std::coroutine_handle<> handle{};
+    if (is_own) {
+      handle = worker.ready.front();
+      worker.ready.pop_front();
+    } else {
+      handle = worker.ready.back();
+      worker.ready.pop_back();
+      this->steal_count.fetch_add(1U, std::memory_order_relaxed);
+    }
+    this->ready_count.fetch_sub(1U);
+    return handle;
+  }
+  return nullptr;
+}
+
+void Executor::fire_timers() {
+  if (Clock::now().time_since_epoch().count() < this->next_timer.load()) {
+    return;
+  }
+  std::vector<std::coroutine_handle<>> due{};
+  {
+    std::lock_guard lock{this->mutex};
+    const Clock::time_point now{Clock::now()};
+    while (!this->timers.empty() and this->timers.top().time <= now) {
+      due.push_back(this->timers.top().handle);
+      this->timers.pop();
+    }
+    this->next_timer.store(
+        this->timers.empty()
+            ? no_timer
+            : this->timers.top().time.time_since_epoch().count());
+  }
+  for (const auto handle : due) {
+    this->schedule(handle);
+  }
+}
+
+void Executor::run(const std::size_t worker_index) {
+  current_executor = this;
+  current_worker = worker_index;
+  while (true) {
+    this->fire_timers();
+    if (const std::coroutine_handle<> handle{this->take(worker_index)}) {
+      handle.resume();
+      continue;
+    }
+
+    std::unique_lock lock{this->mutex};
+    this->sleeping_threads.fetch_add(1U);
+    const auto has_work{[this] {
+      return this->ready_count.load() > 0U or this->is_finished or
+             Clock::now().time_since_epoch().count() >=
+                 this->next_timer.load();
+    }};
+    if (this->timers.empty()) {
+      this->work_available.wait(lock, has_work);
+    } else {
+      this->work_available.wait_until(lock, this->timers.top().time,
+                                      has_work);
+    }
+    this->sleeping_threads.fetch_sub(1U);
+    if (this->is_finished and this->ready_count.load() == 0U) {
+      return;
+    }
+  }
+}
+
+void Executor::finish() {
+  {
+    std::lock_guard lock{this->mutex};
+    this->is_finished = true;
+  }
+  this->work_available.notify_all();
+  for (auto& thread : this->threads) {
+    thread.join();
+  }
+}
+
+Executor::~Executor() {
+  this->finish();
+  // Coroutines still waiting for their timers
+  while (!this->timers.empty()) {
+    this->timers.top().handle.destroy();
+    this->timers.pop();
+  }
+}
+
+Task::Task(const Handle coroutine) noexcept : handle{coroutine} {}
+
+Task::Task(Task&& other) noexcept
+    : handle{std::exchange(other.handle, nullptr)} {}
+
+Task& Task::operator=(Task&& other) noexcept {
+  if (this != &other) {
+    if (this->handle) {
+      this->handle.destroy();
+    }
+    this->handle = std::exchange(other.handle, nullptr);
+  }
+  return *this;
+}
+
+Task::~Task() {
+  if (this->handle) {
+    this->handle.destroy();
+  }
+}
+
+Task Task::promise_type::get_return_object() noexcept {
+  return Task{Handle::from_promise(*this)};
+}
+
+std::suspend_always Task::promise_type::initial_suspend() const noexcept {
+  return {};
+}
+
+Task::FinalAwaiter Task::promise_type::final_suspend() const noexcept {
+  return {};
+}
+
+void Task::promise_type::return_void() const noexcept {}
+
+void Task::promise_type::unhandled_exception() const noexcept {
+  std::terminate();
+}
+
+bool Task::FinalAwaiter::await_ready() const noexcept { return false; }
+
+void Task::FinalAwaiter::await_suspend(const Handle handle) const noexcept {
+  Executor::Group* const group{handle.promise().group};
+  handle.destroy();
+  group->finish_task();
+}
+
+void Task::FinalAwaiter::await_resume() const noexcept {}
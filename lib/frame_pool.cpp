@@ -0,0 +1,159 @@
+// MIT License
+//
+// Copyright (c) 2021-2022 char-lie
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "frame_pool.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <opencv2/core.hpp>
+#include <opencv2/core/mat.hpp>
+#include <vector>
+
+struct FramePool::PooledData : public cv::UMatData {
+  Key key;
+
+  PooledData(const cv::MatAllocator* allocator, const Key data_key)
+      : cv::UMatData{allocator}, key{data_key} {}
+};
+
+std::size_t FramePool::KeyHash::operator()(const Key& key) const noexcept {
+  static constexpr std::size_t multiplier{0x9E3779B97F4A7C15U};
+  std::size_t hash{std::hash<int>{}(key.rows)};
+  hash = hash * multiplier ^ std::hash<int>{}(key.cols);
+  return hash * multiplier ^ std::hash<int>{}(key.type);
+}
+
+FramePool::FramePool(const std::size_t max_idle_size)
+    : max_idle_bytes{max_idle_size} {}
+
+cv::Mat FramePool::acquire(const cv::Size size, const int type) {
+  cv::Mat frame;
+  frame.allocator = this;
+  frame.create(size, type);
+  return frame;
+}
+
+void FramePool::reserve(const cv::Size size, const int type,
+                        const std::size_t count) {
+  std::vector<cv::Mat> frames{};
+  frames.reserve(count);
+  for (std::size_t i{0U}; i < count; ++i) {
+    frames.push_back(this->acquire(size, type));
+    // Faults the pages in, placing them on the NUMA node of the caller
+    frames.back().setTo(cv::Scalar::all(0));
+  }
+  // Released frames stay idle in the pool
+}
+
+FramePool::Stats FramePool::stats() const {
+  std::lock_guard lock{this->mutex};
+  return this->statistics;
+}
+
+void FramePool::trim() {
+  std::lock_guard lock{this->mutex};
+  for (auto& [key, buffers] : this->idle_buffers) {
+    std::for_each(buffers.begin(), buffers.end(), cv::fastFree);
+  }
+  this->idle_buffers.clear();
+  this->statistics.idle_bytes = 0U;
+}
+
+cv::UMatData* FramePool::allocate(const int dims, const int* sizes,
+                                  const int type, void* data, size_t* step,
+                                  const cv::AccessFlag flags,
+                                  const cv::UMatUsageFlags usage_flags) const {
+  if (data != nullptr or dims != 2) {
+    return cv::Mat::getStdAllocator()->allocate(dims, sizes, type, data, step,
+                                                flags, usage_flags);
+  }
+
+  const Key key{sizes[0], sizes[1], type};
+  const auto element_size{static_cast<std::size_t>(CV_ELEM_SIZE(type))};
+  const std::size_t row_size{element_size * static_cast<std::size_t>(key.cols)};
+  const std::size_t size{row_size * static_cast<std::size_t>(key.rows)};
+  if (step != nullptr) {
+    step[0] = row_size;
+    step[1] = element_size;
+  }
+
+  void* buffer{nullptr};
+  {
+    std::lock_guard lock{this->mutex};
+    if (auto found{this->idle_buffers.find(key)};
+        found != this->idle_buffers.end() and !found->second.empty()) {
+      buffer = found->second.back();
+      found->second.pop_back();
+      this->statistics.idle_bytes -= size;
+      ++this->statistics.hits;
+    } else {
+      ++this->statistics.misses;
+    }
+    this->statistics.used_bytes += size;
+    this->statistics.peak_bytes =
+        std::max(this->statistics.peak_bytes,
+                 this->statistics.used_bytes + this->statistics.idle_bytes);
+  }
+  if (buffer == nullptr) {
+    buffer = cv::fastMalloc(size);
+  }
+
+  // NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
+  auto* pooled_data{new PooledData{this, key}};
+  pooled_data->data = pooled_data->origdata = static_cast<uchar*>(buffer);
+  pooled_data->size = size;
+  return pooled_data;
+}
+
+bool FramePool::allocate(cv::UMatData* data, cv::AccessFlag /*access_flags*/,
+                         cv::UMatUsageFlags /*usage_flags*/) const {
+  return data != nullptr;
+}
+
+void FramePool::deallocate(cv::UMatData* data) const {
+  if (data == nullptr) {
+    return;
+  }
+  CV_Assert(data->urefcount == 0 and data->refcount == 0);
+
+  // Only `allocate` above creates data with this allocator
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-static-cast-downcast)
+  auto* pooled_data{static_cast<PooledData*>(data)};
+  void* buffer{pooled_data->origdata};
+  const std::size_t size{pooled_data->size};
+  {
+    std::lock_guard lock{this->mutex};
+    this->statistics.used_bytes -= size;
+    if (this->statistics.idle_bytes + size <= this->max_idle_bytes) {
+      this->idle_buffers[pooled_data->key].push_back(buffer);
+      this->statistics.idle_bytes += size;
+      buffer = nullptr;
+    }
+  }
+  cv::fastFree(buffer);
+  // NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
+  delete pooled_data;
+}
+
+FramePool::~FramePool() { this->trim(); }
@@ -0,0 +1,165 @@
+// MIT License
+//
+// Copyright (c) 2021-2022 char-lie
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "frame_queue.hpp"
+
+#include <coroutine>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+
+#include "executor.hpp"
+#include "frame.hpp"
+
+FrameQueue::FrameQueue(const std::size_t queue_capacity,
+                       const QueuePolicy queue_policy)
+    : capacity{queue_capacity}, policy{queue_policy} {
+  if (this->capacity == 0U) {
+    throw std::runtime_error{"Queue capacity should be positive"};
+  }
+}
+
+FrameQueue::PopAwaiter::PopAwaiter(FrameQueue& frame_queue,
+                                   Executor& resume_executor)
+    : queue{frame_queue}, executor{resume_executor} {}
+
+bool FrameQueue::PopAwaiter::await_ready() const noexcept { return false; }
+
+bool FrameQueue::PopAwaiter::await_suspend(
+    const std::coroutine_handle<> coroutine) {
+  std::unique_lock lock{this->queue.mutex};
+  if (this->queue.is_closed) {
+    return false;
+  }
+  if (!this->queue.frames.empty()) {
+    this->entry.emplace(Entry{std::move(this->queue.frames.front()),
+                              this->queue.popped_frames++});
+    this->queue.frames.pop_front();
+    lock.unlock();
+    this->queue.not_full.notify_one();
+    return false;
+  }
+  // May be resumed by another thread as soon as the lock is released
+  this->handle = coroutine;
+  this->queue.waiters.push_back(this);
+  return true;
+}
+
+std::optional<FrameQueue::Entry> FrameQueue::PopAwaiter::await_resume() {
+  return std::move(this->entry);
+}
+
+FrameQueue::PopAwaiter FrameQueue::async_pop(Executor& executor) {
+  return PopAwaiter{*this, executor};
+}
+
+void FrameQueue::push(Frame frame) {
+  PopAwaiter* waiter{nullptr};
+  {
+    std::unique_lock lock{this->mutex};
+    if (this->policy == QueuePolicy::block) {
+      this->not_full.wait(lock, [this] {
+        return this->frames.size() < this->capacity or this->is_closed;
+      });
+    }
+    if (this->is_closed) {
+      return;
+    }
+
+    if (!this->waiters.empty()) {
+      // The queue is empty while a consumer waits
+      waiter = this->waiters.front();
+      this->waiters.pop_front();
+      waiter->entry.emplace(Entry{std::move(frame), this->popped_frames++});
+    } else {
+      if (this->policy == QueuePolicy::latest_only) {
+        this->dropped_frames += this->frames.size();
+        this->frames.clear();
+      } else if (this->frames.size() == this->capacity) {
+        if (this->policy == QueuePolicy::drop_newest) {
+          ++this->dropped_frames;
+          return;
+        }
+        this->frames.pop_front();
+        ++this->dropped_frames;
+      }
+      this->frames.push_back(std::move(frame));
+    }
+  }
+  if (waiter != nullptr) {
+    waiter->executor.schedule(waiter->handle);
+    return;
+  }
+  this->condition_variable.notify_one();
+}
+
+std::optional<FrameQueue::Entry> FrameQueue::pop() {
+  std::unique_lock lock{this->mutex};
+  this->condition_variable.wait(
+      lock, [this] { return !this->frames.empty() or this->is_closed; });
+  if (this->is_closed) {
+    return std::nullopt;
+  }
+  Entry entry{std::move(this->frames.front()), this->popped_frames++};
+  this->frames.pop_front();
+  lock.unlock();
+  this->not_full.notify_one();
+  return entry;
+}
+
+std::optional<FrameQueue::Entry> FrameQueue::try_pop() {
+  std::unique_lock lock{this->mutex};
+  if (this->frames.empty() or this->is_closed) {
+    return std::nullopt;
+  }
+  Entry entry{std::move(this->frames.front()), this->popped_frames++};
+  this->frames.pop_front();
+  lock.unlock();
+  this->not_full.notify_one();
+  return entry;
+}
+
+void FrameQueue::close() {
+  std::deque<PopAwaiter*> closed_waiters{};
+  {
+    std::lock_guard lock{this->mutex};
+    this->is_closed = true;
+    this->frames.clear();
+    closed_waiters.swap(this->waiters);
+  }
+  this->condition_variable.notify_all();
+  this->not_full.notify_all();
+  for (PopAwaiter* const waiter : closed_waiters) {
+    waiter->executor.schedule(waiter->handle);
+  }
+}
+
+std::size_t FrameQueue::size() {
+  std::lock_guard lock{this->mutex};
+  return this->frames.size();
+}
+
+std::size_t FrameQueue::dropped() {
+  std::lock_guard lock{this->mutex};
+  return this->dropped_frames;
+}
@@ -0,0 +1,103 @@
+// MIT License
+//
+// Copyright (c) 2021-2022 char-lie
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "frame_sink.hpp"
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <opencv2/highgui.hpp>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+
+#include "frame.hpp"
+#include "shared_frame_ring.hpp"
+
+void HighGuiFrameSink::show(const std::string& window_name,
+                            const Frame& frame) {
+  if (this->windows.insert(window_name).second) {
+    cv::namedWindow(window_name);
+  }
+  cv::imshow(window_name, frame.image);
+}
+
+bool HighGuiFrameSink::poll() {
+  constexpr int esc_key{27};
+  constexpr int byte_mask{0xFF};
+  return (cv::waitKey(1) & byte_mask) != esc_key;
+}
+
+void NullFrameSink::show(const std::string& window_name,
+                         const Frame& /*frame*/) {
+  ++this->frame_counts[window_name];
+}
+
+bool NullFrameSink::poll() { return true; }
+
+const std::map<std::string, std::size_t>& NullFrameSink::counts()
+    const noexcept {
+  return this->frame_counts;
+}
+
+SharedMemoryFrameSink::SharedMemoryFrameSink(std::string name_prefix)
+    : prefix{std::move(name_prefix)} {}
+
+void SharedMemoryFrameSink::show(const std::string& window_name,
+                                 const Frame& frame) {
+  const std::size_t frame_size{frame.image.total() *
+                               frame.image.elemSize()};
+  auto ring{this->rings.find(window_name)};
+  if (ring != this->rings.end() and ring->second.capacity() < frame_size) {
+    // Readers see the old ring closed and open the larger one
+    this->rings.erase(ring);
+    ring = this->rings.end();
+  }
+  if (ring == this->rings.end()) {
+    ring = this->rings
+               .emplace(std::piecewise_construct,
+                        std::forward_as_tuple(window_name),
+                        std::forward_as_tuple(
+                            shared_frame_ring_name(this->prefix, window_name),
+                            frame_size))
+               .first;
+  }
+  ring->second.publish(frame.image, frame.capture_time);
+}
+
+bool SharedMemoryFrameSink::poll() { return true; }
+
+std::unique_ptr<FrameSink> make_frame_sink(const std::string& name) {
+  if (name == "highgui") {
+    return std::make_unique<HighGuiFrameSink>();
+  }
+  if (name == "null") {
+    return std::make_unique<NullFrameSink>();
+  }
+  if (const std::string shm_prefix{"shm:"}; name.starts_with(shm_prefix)) {
+    return std::make_unique<SharedMemoryFrameSink>(
+        name.substr(shm_prefix.size()));
+  }
+  throw std::runtime_error{"Unknown sink `" + name +
+                           "`: expected `highgui`, `null` or `shm:PREFIX`"};
+}
@@ -0,0 +1,294 @@
+// MIT License
+//
+// Copyright (c) 2021-2022 char-lie
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "frame_source.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/videoio.hpp>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+VideoFrameSource::VideoFrameSource(const int camera) : capture{camera} {
+  if (!this->capture.isOpened()) {
+    throw std::runtime_error{"Cannot open camera " + std::to_string(camera)};
+  }
+}
+
+VideoFrameSource::VideoFrameSource(const std::string& path) : capture{path} {
+  if (!this->capture.isOpened()) {
+    throw std::runtime_error{"Cannot open video `" + path + "`"};
+  }
+}
+
+bool VideoFrameSource::read(cv::Mat& frame) {
+  return this->capture.read(frame) and !frame.empty();
+}
+
+MjpegFrameSource::MjpegFrameSource(const int camera) : capture{camera} {
+  if (!this->capture.isOpened()) {
+    throw std::runtime_error{"Cannot open camera " + std::to_string(camera)};
+  }
+  if (!this->capture.set(cv::CAP_PROP_FOURCC,
+                         cv::VideoWriter::fourcc('M', 'J', 'P', 'G')) or
+      !this->capture.set(cv::CAP_PROP_CONVERT_RGB, 0.0)) {
+    throw std::runtime_error{"Camera " + std::to_string(camera) +
+                             " cannot deliver raw MJPEG frames"};
+  }
+}
+
+MjpegFrameSource::MjpegFrameSource(const std::string& path) : capture{path} {
+  if (!this->capture.isOpened()) {
+    throw std::runtime_error{"Cannot open video `" + path + "`"};
+  }
+  // Demuxed packets instead of decoded frames
+  if (!this->capture.set(cv::CAP_PROP_FORMAT, -1.0)) {
+    throw std::runtime_error{"Video `" + path +
+                             "` cannot be read without decoding"};
+  }
+}
+
+bool MjpegFrameSource::read(cv::Mat& frame) {
+  return this->capture.read(frame) and !frame.empty();
+}
+
+bool MjpegFrameSource::is_compressed() const noexcept { return true; }
+
+ImageDirectoryFrameSource::ImageDirectoryFrameSource(
+    const std::string& directory) {
+  std::vector<std::filesystem::path> paths{};
+  for (const auto& entry : std::filesystem::directory_iterator{directory}) {
+    if (entry.is_regular_file()) {
+      paths.push_back(entry.path());
+    }
+  }
+  std::sort(paths.begin(), paths.end());
+
+  for (const auto& path : paths) {
+    cv::Mat image{cv::imread(path.string(), cv::IMREAD_COLOR)};
+    if (!image.empty()) {
+      this->images.push_back(std::move(image));
+    }
+  }
+  if (this->images.empty()) {
+    throw std::runtime_error{"No readable images in `" + directory + "`"};
+  }
+}
+
+bool ImageDirectoryFrameSource::read(cv::Mat& frame) {
+  this->images[this->next_image].copyTo(frame);
+  this->next_image = (this->next_image + 1U) % this->images.size();
+  return true;
+}
+
+SyntheticFrameSource::SyntheticFrameSource(const cv::Size frame_resolution,
+                                           const double fps,
+                                           const SyntheticPattern frame_pattern)
+    : resolution{frame_resolution}, pattern{frame_pattern} {
+  if (this->resolution.width <= 0 or this->resolution.height <= 0) {
+    throw std::runtime_error{"Synthetic frame resolution should be positive"};
+  }
+  if (fps < 0.0) {
+    throw std::runtime_error{"Synthetic frame rate should be non-negative"};
+  }
+  if (fps > 0.0) {
+    this->period =
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>{1.0 / fps});
+  }
+}
+
+void SyntheticFrameSource::draw(cv::Mat& frame) const {
+  static constexpr int square_size{64};
+  static constexpr int byte_mask{0xFF};
+  static constexpr int channels{3};
+  // Exclusive upper bound of a byte
+  static constexpr int byte_values{byte_mask + 1};
+  const auto shift{static_cast<int>(this->frame_number % byte_values)};
+
+  if (this->pattern == SyntheticPattern::noise) {
+    cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(byte_values));
+    return;
+  }
+
+  for (int row{0}; row < frame.rows; ++row) {
+    auto* pixel{frame.ptr<uchar>(row)};
+    for (int column{0}; column < frame.cols; ++column) {
+      uchar value{0U};
+      if (this->pattern == SyntheticPattern::gradient) {
+        value = static_cast<uchar>((row + column + shift) & byte_mask);
+      } else {
+        const bool is_white{
+            (row / square_size + (column + shift) / square_size) % 2 == 0};
+        value = is_white ? std::numeric_limits<uchar>::max() : uchar{0U};
+      }
+      for (int channel{0}; channel < channels; ++channel) {
+        *pixel++ = value;
+      }
+    }
+  }
+}
+
+bool SyntheticFrameSource::read(cv::Mat& frame) {
+  if (this->period != std::chrono::steady_clock::duration::zero()) {
+    const auto now{std::chrono::steady_clock::now()};
+    if (this->next_frame_time > now) {
+      std::this_thread::sleep_until(this->next_frame_time);
+      this->next_frame_time += this->period;
+    } else {
+      // Do not try to catch up after a stall
+      this->next_frame_time = now + this->period;
+    }
+  }
+
+  frame.create(this->resolution, CV_8UC3);
+  this->draw(frame);
+  ++this->frame_number;
+  return true;
+}
+
+ReplayFrameSource::ReplayFrameSource(const std::string& path,
+                                     const bool keep_timing)
+    : reader{path}, is_timed{keep_timing} {
+  if (this->reader.size() == 0U) {
+    throw std::runtime_error{"No recorded frames in `" + path + "`"};
+  }
+}
+
+bool ReplayFrameSource::read(cv::Mat& frame) {
+  if (this->next_frame == 0U) {
+    this->pass_start_time = std::chrono::steady_clock::now();
+  }
+  if (this->is_timed) {
+    const FrameStoreReader::Record& record{
+        this->reader.record(this->next_frame)};
+    std::this_thread::sleep_until(this->pass_start_time + record.timestamp);
+  }
+
+  frame = this->reader.frame(this->next_frame);
+  this->next_frame = (this->next_frame + 1U) % this->reader.size();
+  return true;
+}
+
+namespace {
+
+cv::Size parse_resolution(const std::string& resolution) {
+  const cv::Size hd{1280, 720};
+  const cv::Size full_hd{1920, 1080};
+  const cv::Size ultra_hd{3840, 2160};
+  if (resolution == "720p") {
+    return hd;
+  }
+  if (resolution == "1080p") {
+    return full_hd;
+  }
+  if (resolution == "4k") {
+    return ultra_hd;
+  }
+
+  const auto separator{resolution.find('x')};
+  if (separator == std::string::npos) {
+    throw std::runtime_error{"Resolution should look like `WIDTHxHEIGHT`, "
+                             "`720p`, `1080p` or `4k`"};
+  }
+  return {std::stoi(resolution.substr(0U, separator)),
+          std::stoi(resolution.substr(separator + 1U))};
+}
+
+SyntheticPattern parse_pattern(const std::string& pattern) {
+  if (pattern == "gradient") {
+    return SyntheticPattern::gradient;
+  }
+  if (pattern == "checkerboard") {
+    return SyntheticPattern::checkerboard;
+  }
+  if (pattern == "noise") {
+    return SyntheticPattern::noise;
+  }
+  throw std::runtime_error{"Unknown synthetic pattern `" + pattern + "`"};
+}
+
+std::unique_ptr<FrameSource> make_synthetic_frame_source(
+    const std::string& parameters) {
+  static constexpr double default_fps{30.0};
+  const auto pattern_separator{parameters.find(':')};
+  const std::string pattern{pattern_separator == std::string::npos
+                                ? "gradient"
+                                : parameters.substr(pattern_separator + 1U)};
+  const std::string timing{parameters.substr(0U, pattern_separator)};
+
+  const auto fps_separator{timing.find('@')};
+  const double fps{fps_separator == std::string::npos
+                       ? default_fps
+                       : std::stod(timing.substr(fps_separator + 1U))};
+
+  return std::make_unique<SyntheticFrameSource>(
+      parse_resolution(timing.substr(0U, fps_separator)), fps,
+      parse_pattern(pattern));
+}
+
+}  // namespace
+
+std::unique_ptr<FrameSource> make_frame_source(const std::string& description) {
+  const auto separator{description.find(':')};
+  const std::string kind{description.substr(0U, separator)};
+  const std::string parameters{
+      separator == std::string::npos ? "" : description.substr(separator + 1U)};
+
+  if (kind == "camera") {
+    return std::make_unique<VideoFrameSource>(
+        parameters.empty() ? 0 : std::stoi(parameters));
+  }
+  if (kind == "video") {
+    return std::make_unique<VideoFrameSource>(parameters);
+  }
+  if (kind == "mjpeg-camera") {
+    return std::make_unique<MjpegFrameSource>(
+        parameters.empty() ? 0 : std::stoi(parameters));
+  }
+  if (kind == "mjpeg") {
+    return std::make_unique<MjpegFrameSource>(parameters);
+  }
+  if (kind == "images") {
+    return std::make_unique<ImageDirectoryFrameSource>(parameters);
+  }
+  if (kind == "synthetic") {
+    return make_synthetic_frame_source(parameters.empty() ? "720p"
+                                                          : parameters);
+  }
+  if (kind == "replay" or kind == "replay-fast") {
+    return std::make_unique<ReplayFrameSource>(parameters, kind == "replay");
+  }
+  throw std::runtime_error{
+      "Unknown source `" + description +
+      "`: expected `camera:INDEX`, `video:PATH`, `mjpeg-camera:INDEX`, "
+      "`mjpeg:PATH`, `images:DIRECTORY`, `synthetic:RESOLUTION`, "
+      "`replay:PATH` or `replay-fast:PATH`"};
+}
@@ -0,0 +1,193 @@
+// MIT License
+//
+// Copyright (c) 2021-2022 char-lie
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "frame_store.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <opencv2/core/mat.hpp>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr std::array<char, 8U> magic{'F', 'R', 'A', 'M', 'E', 'S', '0', '1'};
+
+struct RecordHeader {
+  std::int64_t timestamp_ns{0};
+  std::uint64_t index{0U};
+  std::int32_t rows{0};
+  std::int32_t cols{0};
+  std::int32_t type{0};
+  std::uint32_t reserved{0U};
+  std::uint64_t data_size{0U};
+};
+static_assert(sizeof(RecordHeader) <= frame_store_alignment);
+
+constexpr std::size_t align(const std::size_t size) {
+  return (size + frame_store_alignment - 1U) / frame_store_alignment *
+         frame_store_alignment;
+}
+
+}  // namespace
+
+FrameStoreWriter::FrameStoreWriter(const std::string& path)
+    : file{path, std::ios::binary | std::ios::trunc} {
+  if (!this->file) {
+    throw std::runtime_error{"Cannot open `" + path + "` for writing"};
+  }
+  this->write(magic.data(), magic.size());
+  this->pad(magic.size());
+}
+
+void FrameStoreWriter::write(const void* data, const std::size_t size) {
+  this->file.write(static_cast<const char*>(data),
+                   static_cast<std::streamsize>(size));
+}
+
+void FrameStoreWriter::pad(const std::size_t size) {
+  static constexpr std::array<char, frame_store_alignment> zeros{};
+  this->write(zeros.data(), align(size) - size);
+}
+
+void FrameStoreWriter::append(
+    const cv::Mat& frame,
+    const std::chrono::steady_clock::time_point capture_time) {
+  if (frame.dims != 2 or frame.empty()) {
+    throw std::runtime_error{"Only non-empty 2D frames can be recorded"};
+  }
+  if (this->frame_count == 0U) {
+    this->first_frame_time = capture_time;
+  }
+
+  const std::size_t row_size{static_cast<std::size_t>(frame.cols) *
+                              frame.elemSize()};
+  const RecordHeader header{
+      .timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          capture_time - this->first_frame_time)
+                          .count(),
+      .index = this->frame_count,
+      .rows = frame.rows,
+      .cols = frame.cols,
+      .type = frame.type(),
+      .data_size = row_size * static_cast<std::size_t>(frame.rows),
+  };
+  this->write(&header, sizeof(header));
+  this->pad(sizeof(header));
+  for (int row{0}; row < frame.rows; ++row) {
+    this->write(frame.ptr(row), row_size);
+  }
+  this->pad(header.data_size);
+  // Whole records only, so a reader of a live recording sees no torn frame
+  this->file.flush();
+  if (!this->file) {
+    throw std::runtime_error{"Cannot write a recorded frame"};
+  }
+  ++this->frame_count;
+}
+
+std::uint64_t FrameStoreWriter::frames() const noexcept {
+  return this->frame_count;
+}
+
+FrameStoreReader::FrameStoreReader(const std::string& path) {
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-vararg,hicpp-vararg)
+  const int file{::open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+  if (file < 0) {
+    throw std::runtime_error{"Cannot open `" + path + "`"};
+  }
+  struct stat status {};
+  if (::fstat(file, &status) != 0 or
+      static_cast<std::size_t>(status.st_size) < align(magic.size())) {
+    ::close(file);
+    throw std::runtime_error{"`" + path + "` is not a frame store"};
+  }
+  this->mapping_size = static_cast<std::size_t>(status.st_size);
+  this->mapping = ::mmap(nullptr, this->mapping_size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE, file, 0);
+  ::close(file);
+  if (this->mapping == MAP_FAILED) {
+    this->mapping = nullptr;
+    throw std::runtime_error{"Cannot map `" + path + "`"};
+  }
+
+  const auto* const bytes{static_cast<const std::byte*>(this->mapping)};
+  if (std::memcmp(bytes, magic.data(), magic.size()) != 0) {
+    ::munmap(this->mapping, this->mapping_size);
+    throw std::runtime_error{"`" + path + "` is not a frame store"};
+  }
+
+  std::size_t offset{align(magic.size())};
+  while (offset + align(sizeof(RecordHeader)) <= this->mapping_size) {
+    RecordHeader header{};
+    std::memcpy(&header, bytes + offset, sizeof(header));
+    const std::size_t data_offset{offset + align(sizeof(header))};
+    if (header.rows <= 0 or header.cols <= 0 or
+        header.data_size > this->mapping_size - data_offset) {
+      // Truncated by an interrupted recording
+      break;
+    }
+    if (header.data_size != static_cast<std::size_t>(header.rows) *
+                                static_cast<std::size_t>(header.cols) *
+                                CV_ELEM_SIZE(header.type)) {
+      ::munmap(this->mapping, this->mapping_size);
+      throw std::runtime_error{"Frame " + std::to_string(header.index) +
+                               " of `" + path + "` is corrupted"};
+    }
+    this->records.push_back({
+        .timestamp = std::chrono::nanoseconds{header.timestamp_ns},
+        .index = header.index,
+        .size = {header.cols, header.rows},
+        .type = header.type,
+        .offset = data_offset,
+    });
+    offset = data_offset + align(header.data_size);
+  }
+}
+
+std::size_t FrameStoreReader::size() const noexcept {
+  return this->records.size();
+}
+
+const FrameStoreReader::Record& FrameStoreReader::record(
+    const std::size_t position) const {
+  return this->records.at(position);
+}
+
+cv::Mat FrameStoreReader::frame(const std::size_t position) const {
+  const Record& frame_record{this->records.at(position)};
+  return {frame_record.size, frame_record.type,
+          static_cast<std::byte*>(this->mapping) + frame_record.offset};
+}
+
+FrameStoreReader::~FrameStoreReader() {
+  if (this->mapping != nullptr) {
+    ::munmap(this->mapping, this->mapping_size);
+  }
+}
@@ -0,0 +1,127 @@
+// MIT License
+//
+// Copyright (c) 2021-2022 char-lie
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "frame_transform.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <opencv2/core.hpp>
+#include <opencv2/core/mat.hpp>
+#include <opencv2/imgproc.hpp>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+#include "frame_bands.hpp"
+#include "gray_conversion.hpp"
+
+void gray_rotate_tile(const cv::Mat& frame, cv::Mat& result,
+                      const cv::RotateFlags rotation, const cv::Rect tile) {
+  static constexpr int channels{3};
+  // Destination of the pixel (`row`, `column`) of the frame and the step
+  // to the destination of (`row`, `column + 1`)
+  const auto destination{[&frame, &result, rotation](const int row,
+                                                     const int column) {
+    switch (rotation) {
+      case cv::ROTATE_90_CLOCKWISE:
+        return std::pair{result.ptr<uchar>(column) + (frame.rows - 1 - row),
+                         static_cast<std::ptrdiff_t>(result.step[0])};
+      case cv::ROTATE_180:
+        return std::pair{
+            result.ptr<uchar>(frame.rows - 1 - row) + (frame.cols - 1 - column),
+            std::ptrdiff_t{-1}};
+      case cv::ROTATE_90_COUNTERCLOCKWISE:
+      default:
+        return std::pair{result.ptr<uchar>(frame.cols - 1 - column) + row,
+                         -static_cast<std::ptrdiff_t>(result.step[0])};
+    }
+  }};
+
+  for (int row{tile.y}; row < tile.y + tile.height; ++row) {
+    const uchar* pixel{frame.ptr<uchar>(row) + tile.x * channels};
+    auto [output, step]{destination(row, tile.x)};
+    for (int column{0}; column < tile.width; ++column) {
+      *output = rgb_to_gray(pixel[0], pixel[1], pixel[2]);
+      pixel += channels;
+      output += step;
+    }
+  }
+}
+
+void gray_rotate(const cv::Mat& frame, cv::Mat& result,
+                 const std::optional<cv::RotateFlags> rotation,
+                 const int bands) {
+  if (!rotation and bands <= 1) {
+    cv::cvtColor(frame, result, cv::COLOR_RGB2GRAY);
+    return;
+  }
+  if (frame.type() != CV_8UC3) {
+    throw std::runtime_error{
+        "Only 3-channel images with [0; 255] intensity range are allowed."};
+  }
+
+  // Keeps the pixels alive even if `result` is `frame`
+  const cv::Mat source{frame};
+  if (!rotation) {
+    result.create(source.rows, source.cols, CV_8UC1);
+    for_each_band(source.rows, bands, 1,
+                  [&source, &result](const cv::Range rows) {
+                    cv::Mat band{result.rowRange(rows)};
+                    cv::cvtColor(source.rowRange(rows), band,
+                                 cv::COLOR_RGB2GRAY);
+                  });
+    return;
+  }
+  if (*rotation == cv::ROTATE_180) {
+    result.create(source.rows, source.cols, CV_8UC1);
+  } else {
+    result.create(source.cols, source.rows, CV_8UC1);
+  }
+
+  // Source tile of 12 KiB and 64 destination cache lines fit L1
+  static constexpr int tile_size{64};
+  for_each_band(
+      source.rows, bands, tile_size,
+      [&source, &result, rotation = *rotation](const cv::Range rows) {
+        for (int row{rows.start}; row < rows.end; row += tile_size) {
+          for (int column{0}; column < source.cols; column += tile_size) {
+            gray_rotate_tile(
+                source, result, rotation,
+                {column, row, std::min(tile_size, source.cols - column),
+                 std::min(tile_size, rows.end - row)});
+          }
+        }
+      });
+}
+
+void mirror(const cv::Mat& frame, cv::Mat& result, const int bands) {
+  for_each_band(frame.rows, bands, 1, [&frame, &result](const cv::Range rows) {
+    cv::Mat band{result.rowRange(rows)};
+    cv::flip(frame.rowRange(rows), band, 1);
+  });
+}
+
+void frame_signature(const cv::Mat& frame, cv::Mat& signature) {
+  static constexpr int columns{32};
+  static constexpr int rows{18};
+  cv::resize(frame, signature, {columns, rows}, 0.0, 0.0, cv::INTER_AREA);
+}
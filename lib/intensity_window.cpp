@@ -0,0 +1,138 @@
+// MIT License
+//
+// Copyright (c) 2021-2022 char-lie
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "intensity_window.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <opencv2/core/mat.hpp>
+#include <stdexcept>
+
+#include "gray_conversion.hpp"
+
+namespace {
+
+constexpr int color_channels{3};
+
+}  // namespace
+
+IntensityWindow::IntensityWindow(const std::size_t length) : frames(length) {
+  if (length == 0U) {
+    throw std::runtime_error{"Intensity window should not be empty"};
+  }
+}
+
+void IntensityWindow::add(const cv::Mat& image) {
+  if (image.type() != CV_8UC3 or image.empty()) {
+    throw std::runtime_error{
+        "Only non-empty 3-channel images with [0; 255] intensity range are "
+        "allowed."};
+  }
+
+  FrameSummary& summary{this->frames[this->next]};
+  if (this->frame_count == this->frames.size()) {
+    for (std::size_t bar{0U}; bar < histogram_bars; ++bar) {
+      this->window.histogram[bar] -= summary.histogram[bar];
+    }
+    this->window.sum -= summary.sum;
+    this->window.squares_sum -= summary.squares_sum;
+    this->window.pixel_count -= summary.pixel_count;
+  } else {
+    ++this->frame_count;
+  }
+
+  summary = FrameSummary{};
+  for (int row{0}; row < image.rows; ++row) {
+    const uchar* const begin{image.ptr<uchar>(row)};
+    const uchar* const end{begin + image.cols * color_channels};
+    for (const uchar* pixel{begin}; pixel != end; pixel += color_channels) {
+      ++summary.histogram[rgb_to_gray(pixel[0], pixel[1], pixel[2])];
+    }
+  }
+  // Sums are derived from the histogram to keep the pixel loop minimal
+  for (std::size_t bar{0U}; bar < histogram_bars; ++bar) {
+    const std::uint64_t count{summary.histogram[bar]};
+    summary.sum += count * bar;
+    summary.squares_sum += count * bar * bar;
+    this->window.histogram[bar] += count;
+  }
+  summary.pixel_count = image.total();
+  this->window.sum += summary.sum;
+  this->window.squares_sum += summary.squares_sum;
+  this->window.pixel_count += summary.pixel_count;
+
+  this->next = (this->next + 1U) % this->frames.size();
+}
+
+void IntensityWindow::clear() noexcept {
+  this->next = 0U;
+  this->frame_count = 0U;
+  this->window = FrameSummary{};
+}
+
+std::size_t IntensityWindow::size() const noexcept { return this->frame_count; }
+
+std::size_t IntensityWindow::length() const noexcept {
+  return this->frames.size();
+}
+
+IntensityWindow::Statistics IntensityWindow::frame_statistics() const {
+  if (this->frame_count == 0U) {
+    throw std::runtime_error{"Intensity window is empty"};
+  }
+  const std::size_t last{(this->next + this->frames.size() - 1U) %
+                         this->frames.size()};
+  return statistics_of(this->frames[last]);
+}
+
+IntensityWindow::Statistics IntensityWindow::statistics() const {
+  if (this->frame_count == 0U) {
+    throw std::runtime_error{"Intensity window is empty"};
+  }
+  return statistics_of(this->window);
+}
+
+const IntensityWindow::Histogram& IntensityWindow::histogram() const noexcept {
+  return this->window.histogram;
+}
+
+IntensityWindow::Statistics IntensityWindow::statistics_of(
+    const FrameSummary& summary) {
+  const auto is_present{[](const std::uint64_t count) { return count > 0U; }};
+  const auto first{std::find_if(summary.histogram.begin(),
+                                summary.histogram.end(), is_present)};
+  const auto last{std::find_if(summary.histogram.rbegin(),
+                               summary.histogram.rend(), is_present)};
+
+  const auto pixel_count{static_cast<double>(summary.pixel_count)};
+  const double mean{static_cast<double>(summary.sum) / pixel_count};
+  return {
+      .pixel_count = summary.pixel_count,
+      .mean = mean,
+      .variance = std::max(
+          static_cast<double>(summary.squares_sum) / pixel_count - mean * mean,
+          0.0),
+      .min = static_cast<uchar>(first - summary.histogram.begin()),
+      .max = static_cast<uchar>(summary.histogram.rend() - last - 1),
+  };
+}
@@ -20,102 +20,367 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include <algorithm>
 #include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
 #include <exception>
 #include <iostream>
-#include <limits>
-#include <opencv2/highgui.hpp>
-#include <opencv2/imgproc.hpp>
+#include <memory>
+#include <mutex>
+#include <opencv2/core.hpp>
+#include <optional>
+#include <set>
 #include <stdexcept>
+#include <stop_token>
+#include <string>
 #include <thread>
+#include <utility>
 
 #include "average_intensity_calculator.hpp"
-#include "circular_buffer.hpp"
-#include "clock_thread.hpp"
-#include "queue_thread.hpp"
+#include "capture_thread.hpp"
+#include "display_slot.hpp"
+#include "executor.hpp"
+#include "frame_pool.hpp"
+#include "frame_queue.hpp"
+#include "frame_sink.hpp"
+#include "frame_source.hpp"
+#include "metrics.hpp"
+#include "options.hpp"
+#include "pipeline.hpp"
+#include "rate_controller.hpp"
+#include "render_thread.hpp"
+#include "stage.hpp"
+#include "stages.hpp"
+#include "thread_settings.hpp"
+#include "worker_pool.hpp"
 
-int main(int argc, char* argv[]) try {
-  if (argc != 2) {
-    throw std::runtime_error{
-        "You should provide exactly one parameter `threshold`, which is a "
-        "non-negative integer"};
+namespace {
+
+const std::string capture_stream{"capture"};
+// Thread settings targets besides the stages
+const std::string capture_target{"capture"};
+const std::string render_target{"render"};
+const std::string pool_target{"pool"};
+
+ThreadSettings thread_settings_of(const Options& options,
+                                  const std::string& target) {
+  const auto found{options.thread_settings.find(target)};
+  return found == options.thread_settings.end() ? ThreadSettings{}
+                                                : found->second;
+}
+
+// Everything a source owns: stages keep their own state per stream
+struct Stream {
+  // Prepended to stage, window and metric names of the stream
+  std::string prefix;
+  std::unique_ptr<FrameSource> source;
+  std::optional<std::string> record_path{};
+  // Set with adaptive decimation
+  std::optional<RateController> gray_rotate_rate{};
+  Pipeline pipeline;
+  std::optional<CaptureThread> capture_thread{};
+
+  Stream(std::string name_prefix, std::unique_ptr<FrameSource> frame_source,
+         Metrics* metrics, WorkerPool* worker_pool)
+      : prefix{std::move(name_prefix)},
+        source{std::move(frame_source)},
+        pipeline{metrics, worker_pool} {}
+  Stream(std::string name_prefix, std::unique_ptr<FrameSource> frame_source,
+         Metrics* metrics, Executor& executor)
+      : prefix{std::move(name_prefix)},
+        source{std::move(frame_source)},
+        pipeline{metrics, executor} {}
+};
+
+AverageIntensityCalculator make_intensity_calculator(const Options& options) {
+  using Method = AverageIntensityCalculator::Method;
+  if (options.intensity_stride == 1) {
+    return AverageIntensityCalculator{Method::fused, {}, options.frame_bands};
   }
+  return AverageIntensityCalculator{Method::sampled,
+                                    {.stride = options.intensity_stride},
+                                    options.frame_bands};
+}
 
-  // Function `atoul` returns `unsigned long`.
-  // It is a bad idea to use `std::uint64_t` here
-  // NOLINTNEXTLINE(google-runtime-int)
-  const std::size_t threshold{[](char* string) -> unsigned long {
-    try {
-      return std::stoul(string);
-    } catch (std::invalid_argument&) {
-      std::cerr << "Threshold should be a non-negative integer" << std::endl;
-      throw;
-    } catch (std::out_of_range&) {
-      std::cerr << "Threshold should be a non-negative integer that is not "
-                   "greater than "
-                // Function `atoul` returns `unsigned long`.
-                // It is a bad idea to use `std::uint64_t` here
-                // NOLINTNEXTLINE(google-runtime-int)
-                << std::numeric_limits<unsigned long>::max() << std::endl;
-      throw;
+// Every displayed stream gets its own window
+void assemble_pipeline(Stream& stream, std::deque<DisplaySlot>& displays,
+                       const Options& options, FramePool& frame_pool,
+                       Metrics& metrics) {
+  // In converted frames at the default decimation
+  static constexpr std::size_t rotation_period{5U};
+  static constexpr std::size_t default_decimation{2U};
+  static constexpr std::chrono::seconds clock_period{1};
+
+  const std::string& prefix{stream.prefix};
+  Pipeline& pipeline{stream.pipeline};
+  // Stage names in the options not matched by a stage yet
+  std::set<std::string> unknown_stages{};
+  for (const auto& [stage, policy] : options.queue_policies) {
+    unknown_stages.insert(stage);
+  }
+  for (const auto& [target, settings] : options.thread_settings) {
+    if (target != capture_target and target != render_target and
+        target != pool_target) {
+      unknown_stages.insert(target);
+    }
+  }
+  const auto add{[&](const std::string& name, std::unique_ptr<Stage> stage,
+                     StageOptions stage_options) {
+    if (const auto found{options.queue_policies.find(name)};
+        found != options.queue_policies.end()) {
+      stage_options.queue_policy = found->second;
     }
-  }(argv[1])};
+    stage_options.thread_settings = thread_settings_of(options, name);
+    unknown_stages.erase(name);
+    pipeline.add(prefix + name, std::move(stage), std::move(stage_options));
+  }};
 
-  const std::string queue_thread_window_name{"Thread 1"};
-  const std::string clock_thread_window_name{"Thread 2"};
+  // Frames of static scenes are detected once, before the full decode,
+  // and the stages below answer them with their previous outputs
+  const bool is_compressed{stream.source->is_compressed()};
+  std::string captured{prefix + capture_stream};
+  if (options.change_threshold) {
+    add("detect_change",
+        std::make_unique<ChangeDetectStage>(
+            static_cast<double>(*options.change_threshold), is_compressed,
+            &metrics.counter(prefix + "detect_change.unchanged")),
+        {.input = captured, .output = "checked"});
+    captured = "checked";
+  }
+  const auto reuse{[&](const std::string& name, std::unique_ptr<Stage> stage,
+                       const std::uint64_t index_period) {
+    if (!options.change_threshold) {
+      return stage;
+    }
+    return std::unique_ptr<Stage>{std::make_unique<ContentReuseStage>(
+        std::move(stage), index_period,
+        &metrics.counter(prefix + name + ".reused"))};
+  }};
+
+  // Compressed frames are decoded once for all consumers but the intensity,
+  // which decodes the few frames it checks at its own resolution
+  std::string frames{captured};
+  if (is_compressed) {
+    add("decode",
+        reuse("decode", std::make_unique<DecodeStage>(frame_pool), 0U),
+        {.input = frames,
+         .output = "decoded",
+         .queue_capacity = options.decode_workers,
+         .workers = options.decode_workers});
+    frames = "decoded";
+  }
+
+  const std::size_t gray_rotate_period{
+      rotation_period * options.decimation.value_or(default_decimation)};
+  std::unique_ptr<Stage> gray_rotate{
+      reuse("gray_rotate",
+           std::make_unique<GrayRotateStage>(frame_pool, gray_rotate_period,
+                                             options.frame_bands),
+           gray_rotate_period)};
+  if (options.decimation) {
+    add("decimate", std::make_unique<DecimateStage>(*options.decimation),
+        {.input = frames, .output = "decimated"});
+  } else {
+    RateController& rate{
+        stream.gray_rotate_rate.emplace(options.transform_workers)};
+    metrics.gauge(prefix + "gray_rotate.admitted_rate",
+                  [&rate]() { return rate.rate(); });
+    add("decimate", std::make_unique<AdaptiveRateStage>(rate),
+        {.input = frames, .output = "decimated"});
+    gray_rotate =
+        std::make_unique<RateMeteredStage>(std::move(gray_rotate), rate);
+  }
+  add("gray_rotate", std::move(gray_rotate),
+      {.input = "decimated",
+       .output = "gray_rotated",
+       .queue_capacity = options.transform_workers,
+       .workers = options.transform_workers});
+  add("display_gray_rotated",
+      std::make_unique<DisplayStage>(
+          displays.emplace_back(prefix + "Thread 1")),
+      {.input = "gray_rotated", .queue_policy = QueuePolicy::latest_only});
 
-  constexpr std::size_t frames_queue_size{10U};
-  CircularBuffer<cv::Mat, frames_queue_size> frames_queue{};
-  AverageIntensityCalculator average_intensity_calculator{};
+  add("throttle", std::make_unique<ThrottleStage>(clock_period),
+      {.input = captured, .output = "throttled"});
+  std::string throttled{"throttled"};
+  if (is_compressed) {
+    add("decode_intensity",
+        reuse("decode_intensity",
+              std::make_unique<DecodeStage>(frame_pool,
+                                            options.intensity_decode_scale),
+              0U),
+        {.input = throttled, .output = "throttled_decoded"});
+    throttled = "throttled_decoded";
+  }
+  add("intensity_flip",
+      reuse("intensity_flip",
+           std::make_unique<IntensityFlipStage>(
+               make_intensity_calculator(options), options.threshold,
+               frame_pool, options.intensity_window, &metrics, prefix,
+               options.frame_bands),
+           0U),
+      {.input = throttled, .output = "flipped"});
+  add("display_flipped",
+      std::make_unique<DisplayStage>(
+          displays.emplace_back(prefix + "Thread 2")),
+      {.input = "flipped", .queue_policy = QueuePolicy::latest_only});
 
-  ThreadHandle queue_thread_handle{queue_thread_window_name};
-  ThreadHandle clock_thread_handle{clock_thread_window_name};
+  if (stream.record_path) {
+    // Absorbs disk stalls, every queued frame holds a capture buffer
+    static constexpr std::size_t record_queue_capacity{16U};
+    // The change detection skips frames and the stages behind it reuse
+    // previous outputs, so with it the recording taps the capture
+    // and decodes on its own
+    std::string recorded{frames};
+    if (options.change_threshold) {
+      recorded = prefix + capture_stream;
+      if (is_compressed) {
+        add("decode_record", std::make_unique<DecodeStage>(frame_pool),
+            {.input = recorded,
+             .output = "record_decoded",
+             .queue_capacity = record_queue_capacity,
+             .dedicated_threads = true});
+        recorded = "record_decoded";
+      }
+    }
+    add("record", std::make_unique<RecordStage>(*stream.record_path),
+        {.input = recorded,
+         .queue_capacity = record_queue_capacity,
+         .dedicated_threads = true});
+  }
 
-  std::thread t1{
-      queue_thread<frames_queue_size>,
-      std::ref(queue_thread_handle),
-      std::ref(frames_queue),
-  };
-  std::thread t2{
-      clock_thread,
-      std::ref(clock_thread_handle),
-      std::ref(average_intensity_calculator),
-      threshold,
-  };
+  if (!unknown_stages.empty()) {
+    throw std::runtime_error{"Unknown stage `" + *unknown_stages.begin() +
+                             "` in the options"};
+  }
+}
 
-  cv::namedWindow(queue_thread_window_name);
-  cv::namedWindow(clock_thread_window_name);
+void wait_for_stop(const std::stop_token& stop_token) {
+  std::mutex mutex{};
+  std::condition_variable_any condition_variable{};
+  std::unique_lock lock{mutex};
+  condition_variable.wait(lock, stop_token, [] { return false; });
+}
 
-  constexpr int default_camera{0};
-  cv::VideoCapture cap(default_camera);
-  cv::Mat image;
+}  // namespace
 
-  if (!cap.isOpened()) {
-    std::cerr << "Cannot open camera" << std::endl;
-    return EXIT_FAILURE;
+int main(int argc, char* argv[]) try {
+  const Options options{parse_options(argc, argv)};
+  if (options.opencv_threads) {
+    cv::setNumThreads(*options.opencv_threads);
   }
+  // Outlives every frame allocated from it
+  FramePool frame_pool{};
 
-  std::chrono::time_point<std::chrono::system_clock> previous_frame_push_time{};
-  bool is_even{false};
-  constexpr int esc_key{27};
-  constexpr int byte_mask{0xFF};
-  while ((cv::waitKey(1) & byte_mask) != esc_key) {
-    cap >> image;
+  const std::unique_ptr<FrameSink> sink{make_frame_sink(options.sink)};
 
-    process_t2(clock_thread_handle, image, previous_frame_push_time);
+  // Outlive the pipelines running on them
+  std::optional<Executor> executor{};
+  std::optional<WorkerPool> worker_pool{};
+  if (options.executor_threads) {
+    executor.emplace(*options.executor_threads,
+                     thread_settings_of(options, pool_target));
+  } else if (options.pool_threads or options.sources.size() > 1U) {
+    worker_pool.emplace(
+        options.pool_threads.value_or(
+            std::max(std::thread::hardware_concurrency(), 1U)),
+        thread_settings_of(options, pool_target));
+  }
 
-    if (is_even) {
-      process_t1(queue_thread_handle, image, frames_queue);
+  // Any thread stops all of them when it is done or fails
+  const std::stop_source stop_source{};
+  Metrics metrics{};
+  std::deque<DisplaySlot> displays{};
+  std::deque<Stream> streams{};
+  for (std::size_t i{0U}; i < options.sources.size(); ++i) {
+    const std::string prefix{
+        options.sources.size() == 1U ? "" : "stream" + std::to_string(i) + "."};
+    std::unique_ptr<FrameSource> source{make_frame_source(options.sources[i])};
+    Stream& stream{
+        executor ? streams.emplace_back(prefix, std::move(source), &metrics,
+                                        *executor)
+                 : streams.emplace_back(prefix, std::move(source), &metrics,
+                                        worker_pool ? &*worker_pool : nullptr)};
+    if (options.record_path) {
+      stream.record_path = options.sources.size() == 1U
+                               ? *options.record_path
+                               : *options.record_path + "." + std::to_string(i);
     }
+    assemble_pipeline(stream, displays, options, frame_pool, metrics);
+    stream.pipeline.stop_on_error(stop_source);
+    stream.pipeline.start();
+  }
+  // Dumps once more when destroyed, after the pipelines have stopped
+  std::optional<MetricsReporter> metrics_reporter{};
+  if (options.metrics_path) {
+    metrics_reporter.emplace(
+        metrics, *options.metrics_path,
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            options.metrics_interval));
+  }
 
-    is_even = !is_even;
+  RenderThread render_thread{*sink, displays, stop_source, &metrics,
+                             thread_settings_of(options, render_target)};
+  for (auto& stream : streams) {
+    stream.capture_thread.emplace(
+        *stream.source, stream.pipeline, stream.prefix + capture_stream,
+        frame_pool,
+        CaptureThread::Settings{
+            .frame_limit = options.frame_limit,
+            .duration_limit = options.duration_limit,
+            .thread_settings = thread_settings_of(options, capture_target)},
+        stop_source, &metrics);
   }
+  wait_for_stop(stop_source.get_token());
 
-  queue_thread_handle.finish();
-  clock_thread_handle.finish();
+  for (auto& stream : streams) {
+    stream.capture_thread->join();
+  }
+  // Every pipeline is stopped before the first stage error is reported
+  std::exception_ptr stage_error{};
+  for (auto& stream : streams) {
+    try {
+      stream.pipeline.stop();
+    } catch (...) {
+      if (!stage_error) {
+        stage_error = std::current_exception();
+      }
+    }
+  }
+  render_thread.join();
+  if (stage_error) {
+    std::rethrow_exception(stage_error);
+  }
 
-  t1.join();
-  t2.join();
+  std::chrono::duration<double> elapsed{0.0};
+  for (const auto& stream : streams) {
+    const std::uint64_t frame_count{stream.capture_thread->frames()};
+    const std::chrono::duration<double> stream_elapsed{
+        stream.capture_thread->elapsed()};
+    elapsed = std::max(elapsed, stream_elapsed);
+    std::cout << stream.prefix << "Captured " << frame_count << " frames in "
+              << stream_elapsed.count() << " s ("
+              << static_cast<double>(frame_count) / stream_elapsed.count()
+              << " fps)" << std::endl;
+  }
+  const FramePool::Stats frame_pool_stats{frame_pool.stats()};
+  std::cout << "Frame pool: " << frame_pool_stats.hits << " hits, "
+            << frame_pool_stats.misses << " misses, "
+            << frame_pool_stats.peak_bytes << " bytes at peak" << std::endl;
+  if (executor) {
+    std::cout << "Executor: " << executor->steals() << " stolen coroutines"
+              << std::endl;
+  }
+  if (const auto* null_sink{dynamic_cast<const NullFrameSink*>(sink.get())};
+      null_sink != nullptr) {
+    for (const auto& [window_name, count] : null_sink->counts()) {
+      std::cout << "Shown " << count << " frames in `" << window_name << "` ("
+                << static_cast<double>(count) / elapsed.count() << " fps)"
+                << std::endl;
+    }
+  }
 
   return EXIT_SUCCESS;
 } catch (std::exception& exception) {
@@ -0,0 +1,314 @@
+// MIT License
+//
+// Copyright (c) 2021-2022 char-lie
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "metrics.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr std::uint64_t sub_buckets{1U << LatencyHistogram::sub_bucket_bits};
+constexpr double nanoseconds_in_second{1e9};
+
+template <typename T>
+T& find_or_create(std::deque<std::pair<std::string, T>>& metrics,
+                  const std::string& name) {
+  const auto found{std::find_if(
+      metrics.begin(), metrics.end(),
+      [&name](const auto& metric) { return metric.first == name; })};
+  if (found != metrics.end()) {
+    return found->second;
+  }
+  return metrics
+      .emplace_back(std::piecewise_construct, std::forward_as_tuple(name),
+                    std::forward_as_tuple())
+      .second;
+}
+
+}  // namespace
+
+std::size_t LatencyHistogram::bucket_of(const std::uint64_t value_ns) noexcept {
+  if (value_ns < sub_buckets) {
+    return value_ns;
+  }
+  const auto exponent{static_cast<unsigned>(std::bit_width(value_ns) - 1)};
+  const unsigned shift{exponent - sub_bucket_bits};
+  return static_cast<std::size_t>(((shift + 1U) << sub_bucket_bits) +
+                                  ((value_ns >> shift) & (sub_buckets - 1U)));
+}
+
+std::uint64_t LatencyHistogram::upper_bound_of(
+    const std::size_t bucket) noexcept {
+  if (bucket < sub_buckets) {
+    return bucket;
+  }
+  const auto shift{static_cast<unsigned>((bucket >> sub_bucket_bits) - 1U)};
+  const std::uint64_t lower{(sub_buckets + (bucket & (sub_buckets - 1U)))
+                            << shift};
+  return lower + ((std::uint64_t{1U} << shift) - 1U);
+}
+
+void LatencyHistogram::record(
+    const std::chrono::nanoseconds duration) noexcept {
+  const auto value_ns{
+      static_cast<std::uint64_t>(std::max(duration.count(), std::int64_t{0}))};
+  this->buckets[bucket_of(value_ns)].fetch_add(1U, std::memory_order_relaxed);
+  this->count.fetch_add(1U, std::memory_order_relaxed);
+  this->sum_ns.fetch_add(value_ns, std::memory_order_relaxed);
+  std::uint64_t max{this->max_ns.load(std::memory_order_relaxed)};
+  while (value_ns > max and
+         !this->max_ns.compare_exchange_weak(max, value_ns,
+                                             std::memory_order_relaxed)) {
+  }
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const {
+  Snapshot snapshot{};
+  snapshot.buckets.reserve(bucket_count);
+  for (const auto& bucket : this->buckets) {
+    snapshot.buckets.push_back(bucket.load(std::memory_order_relaxed));
+  }
+  // Recording is not atomic as a whole, so the count is taken from buckets
+  for (const auto bucket : snapshot.buckets) {
+    snapshot.count += bucket;
+  }
+  snapshot.sum_ns = this->sum_ns.load(std::memory_order_relaxed);
+  snapshot.max_ns = this->max_ns.load(std::memory_order_relaxed);
+  return snapshot;
+}
+
+std::uint64_t LatencyHistogram::Snapshot::quantile_ns(
+    const double quantile) const {
+  if (this->count == 0U) {
+    return 0U;
+  }
+  const auto target{std::max(
+      std::uint64_t{1U},
+      static_cast<std::uint64_t>(
+          std::ceil(quantile * static_cast<double>(this->count))))};
+  std::uint64_t cumulative{0U};
+  for (std::size_t bucket{0U}; bucket < this->buckets.size(); ++bucket) {
+    cumulative += this->buckets[bucket];
+    if (cumulative >= target) {
+      return std::min(upper_bound_of(bucket), this->max_ns);
+    }
+  }
+  return this->max_ns;
+}
+
+std::uint64_t LatencyHistogram::Snapshot::count_not_above(
+    const std::uint64_t bound_ns) const {
+  std::uint64_t result{0U};
+  for (std::size_t bucket{0U};
+       bucket < this->buckets.size() and upper_bound_of(bucket) <= bound_ns;
+       ++bucket) {
+    result += this->buckets[bucket];
+  }
+  return result;
+}
+
+LatencyHistogram& Metrics::histogram(const std::string& name) {
+  std::lock_guard lock{this->mutex};
+  return find_or_create(this->histograms, name);
+}
+
+Counter& Metrics::counter(const std::string& name) {
+  std::lock_guard lock{this->mutex};
+  return find_or_create(this->counters, name);
+}
+
+void Metrics::gauge(std::string name, std::function<double()> read) {
+  std::lock_guard lock{this->mutex};
+  this->gauges.emplace_back(std::move(name), std::move(read));
+}
+
+void Metrics::write_prometheus(std::ostream& stream) {
+  static constexpr std::array<double, 14> bounds_s{
+      0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01,
+      0.025,  0.05,    0.1,    0.25,  0.5,    1.0,   2.5};
+  static constexpr std::array<double, 4> quantiles{0.5, 0.9, 0.99, 0.999};
+  static const std::string prefix{"opencv_multithread_"};
+
+  // Enough for nanoseconds in seconds and short enough for the bounds
+  static constexpr int precision{9};
+
+  std::lock_guard lock{this->mutex};
+  stream << std::setprecision(precision);
+
+  stream << "# TYPE " << prefix << "duration_seconds histogram\n";
+  std::vector<std::pair<std::string, LatencyHistogram::Snapshot>> snapshots{};
+  for (const auto& [name, histogram] : this->histograms) {
+    const auto& snapshot{
+        snapshots.emplace_back(name, histogram.snapshot()).second};
+    for (const double bound_s : bounds_s) {
+      stream << prefix << "duration_seconds_bucket{name=\"" << name
+             << "\",le=\"" << bound_s << "\"} "
+             << snapshot.count_not_above(static_cast<std::uint64_t>(
+                    bound_s * nanoseconds_in_second))
+             << '\n';
+    }
+    stream << prefix << "duration_seconds_bucket{name=\"" << name
+           << "\",le=\"+Inf\"} " << snapshot.count << '\n'
+           << prefix << "duration_seconds_sum{name=\"" << name << "\"} "
+           << static_cast<double>(snapshot.sum_ns) / nanoseconds_in_second
+           << '\n'
+           << prefix << "duration_seconds_count{name=\"" << name << "\"} "
+           << snapshot.count << '\n';
+  }
+
+  stream << "# TYPE " << prefix << "duration_quantile_seconds gauge\n";
+  for (const auto& [name, snapshot] : snapshots) {
+    for (const double quantile : quantiles) {
+      stream << prefix << "duration_quantile_seconds{name=\"" << name
+             << "\",quantile=\"" << quantile << "\"} "
+             << static_cast<double>(snapshot.quantile_ns(quantile)) /
+                    nanoseconds_in_second
+             << '\n';
+    }
+  }
+
+  stream << "# TYPE " << prefix << "events_total counter\n";
+  for (const auto& [name, counter] : this->counters) {
+    stream << prefix << "events_total{name=\"" << name << "\"} "
+           << counter.get() << '\n';
+  }
+
+  stream << "# TYPE " << prefix << "gauge gauge\n";
+  for (const auto& [name, read] : this->gauges) {
+    stream << prefix << "gauge{name=\"" << name << "\"} " << read() << '\n';
+  }
+}
+
+void Metrics::write_csv_header(std::ostream& stream) {
+  stream << "time,name,count,mean_ns,p50_ns,p90_ns,p99_ns,p999_ns,max_ns\n";
+}
+
+void Metrics::write_csv(std::ostream& stream,
+                        const std::chrono::system_clock::time_point time) {
+  static constexpr double p50{0.5};
+  static constexpr double p90{0.9};
+  static constexpr double p99{0.99};
+  static constexpr double p999{0.999};
+  const double seconds{
+      std::chrono::duration<double>{time.time_since_epoch()}.count()};
+
+  std::lock_guard lock{this->mutex};
+  stream << std::fixed << std::setprecision(3);
+  for (const auto& [name, histogram] : this->histograms) {
+    const auto snapshot{histogram.snapshot()};
+    const double mean_ns{
+        snapshot.count == 0U ? 0.0
+                             : static_cast<double>(snapshot.sum_ns) /
+                                   static_cast<double>(snapshot.count)};
+    stream << seconds << ',' << name << ',' << snapshot.count << ','
+           << mean_ns << ',' << snapshot.quantile_ns(p50) << ','
+           << snapshot.quantile_ns(p90) << ',' << snapshot.quantile_ns(p99)
+           << ',' << snapshot.quantile_ns(p999) << ',' << snapshot.max_ns
+           << '\n';
+  }
+  for (const auto& [name, counter] : this->counters) {
+    stream << seconds << ',' << name << ',' << counter.get() << ",,,,,,\n";
+  }
+  for (const auto& [name, read] : this->gauges) {
+    stream << seconds << ',' << name << ',' << read() << ",,,,,,\n";
+  }
+}
+
+MetricsReporter::MetricsReporter(
+    Metrics& reported_metrics, std::string file_path,
+    const std::chrono::steady_clock::duration dump_interval)
+    : metrics{reported_metrics},
+      path{std::move(file_path)},
+      interval{dump_interval} {
+  if (this->path.ends_with(".csv")) {
+    std::ofstream file{this->path, std::ios::trunc};
+    if (!file) {
+      throw std::runtime_error{"Cannot open `" + this->path +
+                               "` for writing"};
+    }
+    Metrics::write_csv_header(file);
+  }
+  this->thread = std::thread{&MetricsReporter::run, this};
+}
+
+void MetricsReporter::dump() {
+  if (this->path.ends_with(".csv")) {
+    std::ofstream file{this->path, std::ios::app};
+    this->metrics.write_csv(file, std::chrono::system_clock::now());
+    return;
+  }
+
+  // Readers never see a partially written file
+  const std::string temporary_path{this->path + ".tmp"};
+  {
+    std::ofstream file{temporary_path, std::ios::trunc};
+    this->metrics.write_prometheus(file);
+  }
+  std::filesystem::rename(temporary_path, this->path);
+}
+
+void MetricsReporter::run() {
+  std::unique_lock lock{this->mutex};
+  while (!this->condition_variable.wait_for(
+      lock, this->interval, [this] { return this->is_finished; })) {
+    lock.unlock();
+    try {
+      this->dump();
+    } catch (std::exception& exception) {
+      std::cerr << "Cannot dump metrics: '" << exception.what() << "'"
+                << std::endl;
+    }
+    lock.lock();
+  }
+}
+
+MetricsReporter::~MetricsReporter() {
+  {
+    std::lock_guard lock{this->mutex};
+    this->is_finished = true;
+  }
+  this->condition_variable.notify_one();
+  this->thread.join();
+  try {
+    this->dump();
+  } catch (...) {
+    // Destructors should not throw
+  }
+}
@@ -0,0 +1,262 @@
+// MIT License
+//
+// Copyright (c) 2021-2022 char-lie
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "options.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "frame_queue.hpp"
+#include "thread_settings.hpp"
+
+namespace {
+
+// Function `atoul` returns `unsigned long`.
+// It is a bad idea to use `std::uint64_t` here
+// NOLINTNEXTLINE(google-runtime-int)
+unsigned long parse_non_negative(const std::string& name,
+                                 const std::string& string) {
+  try {
+    if (string.starts_with('-')) {
+      throw std::invalid_argument{string};
+    }
+    return std::stoul(string);
+  } catch (std::invalid_argument&) {
+    std::cerr << name << " should be a non-negative integer" << std::endl;
+    throw;
+  } catch (std::out_of_range&) {
+    std::cerr << name
+              << " should be a non-negative integer that is not "
+                 "greater than "
+              // Function `atoul` returns `unsigned long`.
+              // It is a bad idea to use `std::uint64_t` here
+              // NOLINTNEXTLINE(google-runtime-int)
+              << std::numeric_limits<unsigned long>::max() << std::endl;
+    throw;
+  }
+}
+
+std::chrono::duration<double> parse_seconds(const std::string& name,
+                                            const std::string& string) {
+  const double seconds{std::stod(string)};
+  if (seconds <= 0.0) {
+    throw std::runtime_error{name + " should be positive"};
+  }
+  return std::chrono::duration<double>{seconds};
+}
+
+// Splits `TARGET=VALUE`
+std::pair<std::string, std::string> parse_assignment(
+    const std::string& name, const std::string& string) {
+  const auto separator{string.find('=')};
+  if (separator == std::string::npos) {
+    throw std::runtime_error{name + " should look like `TARGET=VALUE`"};
+  }
+  return {string.substr(0U, separator), string.substr(separator + 1U)};
+}
+
+int parse_cpu(const std::string& string) {
+  const auto cpu{parse_non_negative("CPU", string)};
+  if (cpu > std::numeric_limits<int>::max()) {
+    throw std::runtime_error{"CPU " + string + " is out of range"};
+  }
+  return static_cast<int>(cpu);
+}
+
+// Parses a list like `0-3,8`
+std::vector<int> parse_cpu_list(const std::string& string) {
+  std::vector<int> cpus{};
+  std::size_t begin{0U};
+  while (begin <= string.size()) {
+    const auto end{std::min(string.find(',', begin), string.size())};
+    const std::string range{string.substr(begin, end - begin)};
+    const auto dash{range.find('-')};
+    const int first{parse_cpu(range.substr(0U, dash))};
+    const int last{dash == std::string::npos
+                       ? first
+                       : parse_cpu(range.substr(dash + 1U))};
+    if (last < first) {
+      throw std::runtime_error{"CPU range `" + range + "` is empty"};
+    }
+    for (int cpu{first}; cpu <= last; ++cpu) {
+      cpus.push_back(cpu);
+    }
+    begin = end + 1U;
+  }
+  return cpus;
+}
+
+QueuePolicy parse_queue_policy(const std::string& policy) {
+  if (policy == "drop-oldest") {
+    return QueuePolicy::drop_oldest;
+  }
+  if (policy == "drop-newest") {
+    return QueuePolicy::drop_newest;
+  }
+  if (policy == "block") {
+    return QueuePolicy::block;
+  }
+  if (policy == "latest-only") {
+    return QueuePolicy::latest_only;
+  }
+  throw std::runtime_error{"Unknown queue policy `" + policy + "`"};
+}
+
+}  // namespace
+
+Options parse_options(int argc, char* argv[]) {
+  const std::span<char*> arguments{argv, static_cast<std::size_t>(argc)};
+  if (arguments.size() < 2U or arguments.size() % 2U != 0U) {
+    throw std::runtime_error{
+        "Usage: main THRESHOLD [--source SOURCE]... [--sink SINK] "
+        "[--frames COUNT] [--duration SECONDS] [--decimation PERIOD|auto] "
+        "[--transform-workers COUNT] [--frame-bands COUNT] "
+        "[--decode-workers COUNT] [--change-threshold LEVELS] "
+        "[--queue-policy STAGE=drop-oldest|drop-newest|block|latest-only]... "
+        "[--pool-threads COUNT] [--executor-threads COUNT] "
+        "[--affinity TARGET=CPUS]... "
+        "[--realtime-priority TARGET=PRIORITY]... [--opencv-threads COUNT] "
+        "[--intensity-window FRAMES] [--intensity-stride STRIDE] "
+        "[--intensity-decode-scale 1|2|4|8] "
+        "[--record PATH] [--metrics PATH] [--metrics-interval SECONDS]\n"
+        "`THRESHOLD` is a non-negative integer"};
+  }
+
+  Options options{};
+  options.threshold = parse_non_negative("Threshold", arguments[1]);
+
+  for (std::size_t i{2U}; i < arguments.size(); i += 2U) {
+    const std::string name{arguments[i]};
+    const std::string value{arguments[i + 1U]};
+    if (name == "--source") {
+      options.sources.push_back(value);
+    } else if (name == "--sink") {
+      options.sink = value;
+    } else if (name == "--frames") {
+      options.frame_limit = parse_non_negative("Frames count", value);
+    } else if (name == "--duration") {
+      options.duration_limit = parse_seconds("Duration", value);
+    } else if (name == "--decimation") {
+      options.decimation =
+          value == "auto"
+              ? std::nullopt
+              : std::optional{parse_non_negative("Decimation period", value)};
+      if (options.decimation == 0U) {
+        throw std::runtime_error{"Decimation period should be positive"};
+      }
+    } else if (name == "--transform-workers") {
+      options.transform_workers =
+          parse_non_negative("Transform workers count", value);
+      if (options.transform_workers == 0U) {
+        throw std::runtime_error{"There should be at least one worker"};
+      }
+    } else if (name == "--frame-bands") {
+      const auto bands{parse_non_negative("Frame bands count", value)};
+      if (bands == 0U or bands > std::numeric_limits<int>::max()) {
+        throw std::runtime_error{"Frame bands count is out of range"};
+      }
+      options.frame_bands = static_cast<int>(bands);
+    } else if (name == "--decode-workers") {
+      options.decode_workers =
+          parse_non_negative("Decode workers count", value);
+      if (options.decode_workers == 0U) {
+        throw std::runtime_error{"There should be at least one decoder"};
+      }
+    } else if (name == "--change-threshold") {
+      options.change_threshold =
+          parse_non_negative("Change threshold", value);
+    } else if (name == "--queue-policy") {
+      const auto [stage, policy]{parse_assignment("Queue policy", value)};
+      options.queue_policies[stage] = parse_queue_policy(policy);
+    } else if (name == "--pool-threads") {
+      options.pool_threads = parse_non_negative("Pool threads count", value);
+      if (options.pool_threads == 0U) {
+        throw std::runtime_error{"There should be at least one pool thread"};
+      }
+    } else if (name == "--executor-threads") {
+      options.executor_threads =
+          parse_non_negative("Executor threads count", value);
+      if (options.executor_threads == 0U) {
+        throw std::runtime_error{
+            "There should be at least one executor thread"};
+      }
+    } else if (name == "--affinity") {
+      const auto [target, cpus]{parse_assignment("Affinity", value)};
+      options.thread_settings[target].cpus = parse_cpu_list(cpus);
+    } else if (name == "--realtime-priority") {
+      const auto [target, priority]{
+          parse_assignment("Real-time priority", value)};
+      options.thread_settings[target].realtime_priority =
+          std::stoi(priority);
+    } else if (name == "--opencv-threads") {
+      const auto count{parse_non_negative("OpenCV threads count", value)};
+      if (count > std::numeric_limits<int>::max()) {
+        throw std::runtime_error{"OpenCV threads count is out of range"};
+      }
+      options.opencv_threads = static_cast<int>(count);
+    } else if (name == "--intensity-window") {
+      options.intensity_window =
+          parse_non_negative("Intensity window length", value);
+      if (options.intensity_window == 0U) {
+        throw std::runtime_error{"Intensity window should not be empty"};
+      }
+    } else if (name == "--intensity-stride") {
+      const auto stride{parse_non_negative("Intensity sampling stride", value)};
+      if (stride == 0U or stride > std::numeric_limits<int>::max()) {
+        throw std::runtime_error{"Intensity sampling stride is out of range"};
+      }
+      options.intensity_stride = static_cast<int>(stride);
+    } else if (name == "--intensity-decode-scale") {
+      const auto scale{parse_non_negative("Intensity decode scale", value)};
+      if (scale != 1U and scale != 2U and scale != 4U and scale != 8U) {
+        throw std::runtime_error{"Intensity decode scale should be 1, 2, 4 "
+                                 "or 8"};
+      }
+      options.intensity_decode_scale = static_cast<int>(scale);
+    } else if (name == "--record") {
+      options.record_path = value;
+    } else if (name == "--metrics") {
+      options.metrics_path = value;
+    } else if (name == "--metrics-interval") {
+      options.metrics_interval = parse_seconds("Metrics interval", value);
+    } else {
+      throw std::runtime_error{"Unknown option `" + name + "`"};
+    }
+  }
+  if (options.pool_threads and options.executor_threads) {
+    throw std::runtime_error{
+        "Stages run either on a worker pool or on an executor"};
+  }
+  if (options.sources.empty()) {
+    options.sources.emplace_back("camera:0");
+  }
+
+  return options;
+}
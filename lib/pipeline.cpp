@@ -0,0 +1,346 @@
+// MIT License
+//
+// Copyright (c) 2021-2022 char-lie
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pipeline.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <stdexcept>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "executor.hpp"
+#include "frame.hpp"
+#include "frame_queue.hpp"
+#include "metrics.hpp"
+#include "stage.hpp"
+#include "thread_settings.hpp"
+#include "worker_pool.hpp"
+
+Pipeline::Node::Node(std::string node_name, std::unique_ptr<Stage> node_stage,
+                     StageOptions node_options)
+    : name{std::move(node_name)},
+      stage{std::move(node_stage)},
+      coroutine_stage{dynamic_cast<CoroutineStage*>(this->stage.get())},
+      options{std::move(node_options)},
+      queue{this->options.queue_capacity, this->options.queue_policy} {
+  if (this->options.workers == 0U) {
+    throw std::runtime_error{"Stage `" + this->name +
+                             "` should have at least one worker"};
+  }
+}
+
+Pipeline::Pipeline(Metrics* pipeline_metrics, WorkerPool* worker_pool)
+    : metrics{pipeline_metrics} {
+  if (worker_pool != nullptr) {
+    this->lane = std::make_unique<WorkerPool::Lane>(*worker_pool);
+  }
+}
+
+Pipeline::Pipeline(Metrics* pipeline_metrics, Executor& stage_executor)
+    : metrics{pipeline_metrics},
+      executor{&stage_executor},
+      coroutines{std::make_unique<Executor::Group>(stage_executor)} {}
+
+void Pipeline::add(std::string name, std::unique_ptr<Stage> stage,
+                   StageOptions options) {
+  if (this->is_running) {
+    throw std::runtime_error{"Stages cannot be added to a running pipeline"};
+  }
+  for (const auto& node : this->nodes) {
+    if (node->name == name) {
+      throw std::runtime_error{"Duplicate stage `" + name + "`"};
+    }
+  }
+  this->nodes.push_back(std::make_unique<Node>(std::move(name),
+                                               std::move(stage),
+                                               std::move(options)));
+}
+
+void Pipeline::stop_on_error(std::stop_source stop_source) {
+  this->error_stop_source = std::move(stop_source);
+}
+
+void Pipeline::connect() {
+  this->consumers_by_stream.clear();
+  for (const auto& node : this->nodes) {
+    node->consumers.clear();
+    this->consumers_by_stream[node->options.input].push_back(node.get());
+  }
+  for (const auto& node : this->nodes) {
+    if (const auto found{this->consumers_by_stream.find(node->options.output)};
+        !node->options.output.empty() and
+        found != this->consumers_by_stream.end()) {
+      node->consumers = found->second;
+    }
+  }
+
+  // Depth-first search for cycles
+  std::set<const Node*> visited{};
+  std::set<const Node*> path{};
+  const std::function<void(const Node&)> visit{
+      [&visit, &visited, &path](const Node& node) {
+        if (path.contains(&node)) {
+          throw std::runtime_error{"Stage `" + node.name +
+                                   "` depends on its own output"};
+        }
+        if (!visited.insert(&node).second) {
+          return;
+        }
+        path.insert(&node);
+        for (const Node* consumer : node.consumers) {
+          visit(*consumer);
+        }
+        path.erase(&node);
+      }};
+  for (const auto& node : this->nodes) {
+    visit(*node);
+  }
+}
+
+void Pipeline::register_metrics() {
+  if (this->metrics == nullptr) {
+    return;
+  }
+  for (const auto& node : this->nodes) {
+    if (node->service_time != nullptr) {
+      continue;
+    }
+    node->service_time = &this->metrics->histogram(node->name + ".service");
+    node->latency = &this->metrics->histogram(node->name + ".latency");
+    node->filtered_frames = &this->metrics->counter(node->name + ".filtered");
+    FrameQueue& queue{node->queue};
+    this->metrics->gauge(node->name + ".queue_depth", [&queue]() {
+      return static_cast<double>(queue.size());
+    });
+    this->metrics->gauge(node->name + ".queue_dropped", [&queue]() {
+      return static_cast<double>(queue.dropped());
+    });
+  }
+}
+
+void Pipeline::start() {
+  if (this->is_running) {
+    return;
+  }
+  if (this->lane or this->coroutines) {
+    for (const auto& node : this->nodes) {
+      if (node->options.queue_policy == QueuePolicy::block) {
+        throw std::runtime_error{"Stage `" + node->name +
+                                 "` cannot block on shared threads"};
+      }
+    }
+  }
+  this->connect();
+  this->register_metrics();
+  this->is_running = true;
+  for (const auto& node : this->nodes) {
+    node->error_stop_source = this->error_stop_source;
+    if (this->lane and !node->options.dedicated_threads) {
+      node->lane = this->lane.get();
+      continue;
+    }
+    if (this->coroutines and !node->options.dedicated_threads) {
+      for (std::size_t i{0U}; i < node->options.workers; ++i) {
+        this->coroutines->spawn(
+            Pipeline::run_coroutine(*node, *this->executor));
+      }
+      continue;
+    }
+    for (std::size_t i{0U}; i < node->options.workers; ++i) {
+      node->threads.emplace_back(Pipeline::run, std::ref(*node));
+      // On failure the started threads are joined by `stop`
+      apply_thread_settings(node->threads.back(),
+                            node->options.thread_settings);
+    }
+  }
+}
+
+void Pipeline::deliver(const std::vector<Node*>& consumers, Frame frame) {
+  for (std::size_t i{0U}; i + 1U < consumers.size(); ++i) {
+    consumers[i]->queue.push(frame);
+    Pipeline::schedule(*consumers[i]);
+  }
+  if (!consumers.empty()) {
+    consumers.back()->queue.push(std::move(frame));
+    Pipeline::schedule(*consumers.back());
+  }
+}
+
+void Pipeline::process(Node& node, FrameQueue::Entry entry) {
+  const auto start_time{std::chrono::steady_clock::now()};
+  auto output{node.stage->process(std::move(entry.frame))};
+  Pipeline::complete(node, entry.sequence, std::move(output), start_time);
+}
+
+void Pipeline::complete(
+    Node& node, const std::uint64_t sequence, std::optional<Frame> output,
+    const std::chrono::steady_clock::time_point start_time) {
+  if (node.service_time != nullptr) {
+    const auto end_time{std::chrono::steady_clock::now()};
+    node.service_time->record(end_time - start_time);
+    if (output) {
+      node.latency->record(end_time - output->capture_time);
+    } else {
+      node.filtered_frames->add();
+    }
+  }
+  if (node.options.workers == 1U) {
+    if (output) {
+      Pipeline::deliver(node.consumers, std::move(*output));
+    }
+    return;
+  }
+  node.reorder_buffer.complete(
+      sequence, std::move(output), [&node](Frame frame) {
+        Pipeline::deliver(node.consumers, std::move(frame));
+      });
+}
+
+void Pipeline::record_error(Node& node) {
+  {
+    std::lock_guard lock{node.error_mutex};
+    if (!node.error) {
+      node.error = std::current_exception();
+    }
+  }
+  node.error_stop_source.request_stop();
+}
+
+void Pipeline::run(Node& node) {
+  try {
+    while (auto entry{node.queue.pop()}) {
+      Pipeline::process(node, std::move(*entry));
+    }
+  } catch (...) {
+    Pipeline::record_error(node);
+    // The stage takes no more frames, so producers cannot wait for it
+    node.queue.close();
+  }
+}
+
+void Pipeline::step(Node& node) {
+  if (auto entry{node.queue.try_pop()}) {
+    try {
+      Pipeline::process(node, std::move(*entry));
+    } catch (...) {
+      Pipeline::record_error(node);
+      // Like a failed stage thread, the stage takes no more frames
+      node.queue.close();
+    }
+  }
+  {
+    std::lock_guard lock{node.schedule_mutex};
+    --node.scheduled_tasks;
+  }
+  Pipeline::schedule(node);
+}
+
+Task Pipeline::run_coroutine(Node& node, Executor& executor) {
+  try {
+    while (auto entry{co_await node.queue.async_pop(executor)}) {
+      if (node.coroutine_stage == nullptr) {
+        Pipeline::process(node, std::move(*entry));
+      } else {
+        const auto start_time{std::chrono::steady_clock::now()};
+        std::optional<Frame> output{
+            co_await node.coroutine_stage->process_async(
+                std::move(entry->frame), executor)};
+        Pipeline::complete(node, entry->sequence, std::move(output),
+                           start_time);
+      }
+      // Like the worker pool tasks, busy stages take turns
+      co_await executor.yield();
+    }
+  } catch (...) {
+    Pipeline::record_error(node);
+    // Like a failed stage thread, the stage takes no more frames
+    node.queue.close();
+  }
+}
+
+// Every queued frame is seen either here after the push or by the task
+// finishing afterwards
+void Pipeline::schedule(Node& node) {
+  if (node.lane == nullptr) {
+    return;
+  }
+  std::lock_guard lock{node.schedule_mutex};
+  if (node.scheduled_tasks < node.options.workers and node.queue.size() > 0U) {
+    ++node.scheduled_tasks;
+    node.lane->post([&node] { Pipeline::step(node); });
+  }
+}
+
+void Pipeline::push(const std::string& stream, Frame frame) {
+  if (const auto found{this->consumers_by_stream.find(stream)};
+      found != this->consumers_by_stream.end()) {
+    Pipeline::deliver(found->second, std::move(frame));
+  }
+}
+
+void Pipeline::stop() {
+  if (!this->is_running) {
+    return;
+  }
+  for (const auto& node : this->nodes) {
+    node->queue.close();
+  }
+  if (this->lane) {
+    this->lane->wait_idle();
+  }
+  if (this->coroutines) {
+    this->coroutines->wait();
+  }
+  for (const auto& node : this->nodes) {
+    node->lane = nullptr;
+    for (auto& thread : node->threads) {
+      thread.join();
+    }
+    node->threads.clear();
+  }
+  this->is_running = false;
+
+  for (const auto& node : this->nodes) {
+    if (node->error) {
+      std::rethrow_exception(std::exchange(node->error, nullptr));
+    }
+  }
+}
+
+Pipeline::~Pipeline() {
+  try {
+    this->stop();
+  } catch (...) {
+    // Call `stop` explicitly to handle stage errors
+  }
+}
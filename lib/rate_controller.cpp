@@ -0,0 +1,94 @@
+// MIT License
+//
+// Copyright (c) 2021-2022 char-lie
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "rate_controller.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <stdexcept>
+
+RateController::RateController(const std::size_t consumer_workers,
+                               const double consumer_target_utilization,
+                               const double service_time_smoothing)
+    : workers{static_cast<double>(consumer_workers)},
+      target_utilization{consumer_target_utilization},
+      smoothing{service_time_smoothing} {
+  if (consumer_workers == 0U) {
+    throw std::runtime_error{"There should be at least one worker"};
+  }
+  if (this->target_utilization <= 0.0 or this->target_utilization > 1.0) {
+    throw std::runtime_error{"Target utilization should be in (0; 1]"};
+  }
+  if (this->smoothing <= 0.0 or this->smoothing > 1.0) {
+    throw std::runtime_error{"Smoothing should be in (0; 1]"};
+  }
+}
+
+void RateController::record(
+    const std::chrono::steady_clock::duration service_time) {
+  const double seconds{
+      std::chrono::duration<double>{service_time}.count()};
+  std::lock_guard lock{this->mutex};
+  this->service_seconds =
+      this->service_seconds
+          ? *this->service_seconds +
+                this->smoothing * (seconds - *this->service_seconds)
+          : seconds;
+}
+
+bool RateController::admit(
+    const std::chrono::steady_clock::time_point arrival_time) {
+  std::lock_guard lock{this->mutex};
+  if (!this->service_seconds or *this->service_seconds <= 0.0) {
+    return true;
+  }
+
+  const double frames_per_second{this->workers * this->target_utilization /
+                                 *this->service_seconds};
+  if (this->refill_time) {
+    const std::chrono::duration<double> elapsed{arrival_time -
+                                                *this->refill_time};
+    // A burst fills every worker, then frames come at the sustained rate
+    this->tokens = std::min(
+        this->tokens + std::max(elapsed.count(), 0.0) * frames_per_second,
+        this->workers);
+  } else {
+    this->tokens = this->workers;
+  }
+  this->refill_time = arrival_time;
+
+  if (this->tokens < 1.0) {
+    return false;
+  }
+  this->tokens -= 1.0;
+  return true;
+}
+
+double RateController::rate() {
+  std::lock_guard lock{this->mutex};
+  if (!this->service_seconds or *this->service_seconds <= 0.0) {
+    return 0.0;
+  }
+  return this->workers * this->target_utilization / *this->service_seconds;
+}
@@ -0,0 +1,118 @@
+// MIT License
+//
+// Copyright (c) 2021-2022 char-lie
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "render_thread.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <optional>
+#include <stop_token>
+#include <thread>
+#include <utility>
+
+#include "display_slot.hpp"
+#include "frame.hpp"
+#include "frame_sink.hpp"
+#include "metrics.hpp"
+#include "thread_settings.hpp"
+
+RenderThread::RenderThread(FrameSink& frame_sink,
+                           std::deque<DisplaySlot>& display_slots,
+                           std::stop_source shared_stop_source,
+                           Metrics* metrics,
+                           const ThreadSettings& thread_settings)
+    : sink{frame_sink},
+      displays{display_slots},
+      stop_source{std::move(shared_stop_source)} {
+  if (metrics != nullptr) {
+    for (const auto& display : this->displays) {
+      this->display_latencies.push_back(
+          &metrics->histogram(display.window_name + ".display"));
+      metrics->gauge(display.window_name + ".skipped", [&display]() {
+        return static_cast<double>(display.skipped());
+      });
+    }
+  }
+  this->thread = std::thread{&RenderThread::run, this};
+  try {
+    apply_thread_settings(this->thread, thread_settings);
+  } catch (...) {
+    this->stop_source.request_stop();
+    this->thread.join();
+    throw;
+  }
+}
+
+bool RenderThread::show_new_frames() {
+  bool is_shown{false};
+  for (std::size_t i{0U}; i < this->displays.size(); ++i) {
+    std::optional<Frame> frame{this->displays[i].take()};
+    if (!frame) {
+      continue;
+    }
+    this->sink.show(this->displays[i].window_name, *frame);
+    if (!this->display_latencies.empty()) {
+      this->display_latencies[i]->record(std::chrono::steady_clock::now() -
+                                         frame->capture_time);
+    }
+    is_shown = true;
+  }
+  return is_shown;
+}
+
+void RenderThread::run() {
+  const std::stop_token stop_token{this->stop_source.get_token()};
+  try {
+    while (!stop_token.stop_requested()) {
+      const bool is_shown{this->show_new_frames()};
+      if (!this->sink.poll()) {
+        break;
+      }
+      if (!is_shown) {
+        std::this_thread::sleep_for(idle_period);
+      }
+    }
+  } catch (...) {
+    this->error = std::current_exception();
+  }
+  this->stop_source.request_stop();
+}
+
+void RenderThread::join() {
+  this->stop_source.request_stop();
+  if (this->thread.joinable()) {
+    this->thread.join();
+  }
+  if (this->error) {
+    std::rethrow_exception(std::exchange(this->error, nullptr));
+  }
+}
+
+RenderThread::~RenderThread() {
+  try {
+    this->join();
+  } catch (...) {
+    // Call `join` explicitly to handle render errors
+  }
+}
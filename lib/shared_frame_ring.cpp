@@ -0,0 +1,302 @@
+// MIT License
+//
+// Copyright (c) 2021-2022 char-lie
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "shared_frame_ring.hpp"
+
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <opencv2/core/mat.hpp>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+namespace {
+
+// "FRMRING1"
+constexpr std::uint64_t magic{0x31474E49524D5246U};
+
+// Shared with other processes, so only address-free atomics
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free);
+static_assert(std::atomic<std::int64_t>::is_always_lock_free);
+static_assert(std::atomic<std::int32_t>::is_always_lock_free);
+
+struct RingHeader {
+  // Stored last, once the rest of the segment is initialized
+  std::atomic<std::uint64_t> magic{0U};
+  std::uint64_t slot_count{0U};
+  // Of a slot with its header
+  std::uint64_t slot_size{0U};
+  std::uint64_t frame_capacity{0U};
+  // Sequence number of the latest complete frame, 0 before the first one
+  std::atomic<std::uint64_t> latest{0U};
+  // Set by the writer once it publishes no more frames
+  std::atomic<std::uint64_t> is_closed{0U};
+};
+
+// The fields are atomic because readers load them while they may be
+// overwritten: a sequence changed meanwhile tells them to discard the values
+struct SlotHeader {
+  // `2 * sequence - 1` while the frame is written, `2 * sequence` after
+  std::atomic<std::uint64_t> sequence{0U};
+  std::atomic<std::int64_t> timestamp_ns{0};
+  std::atomic<std::int32_t> rows{0};
+  std::atomic<std::int32_t> cols{0};
+  std::atomic<std::int32_t> type{0};
+  std::atomic<std::uint64_t> data_size{0U};
+};
+
+constexpr std::size_t align(const std::size_t size) {
+  return (size + shared_frame_ring_alignment - 1U) /
+         shared_frame_ring_alignment * shared_frame_ring_alignment;
+}
+
+RingHeader& ring_header(void* mapping) {
+  return *static_cast<RingHeader*>(mapping);
+}
+
+std::byte* slot_address(void* mapping, const std::uint64_t sequence) {
+  const RingHeader& header{ring_header(mapping)};
+  return static_cast<std::byte*>(mapping) + align(sizeof(RingHeader)) +
+         (sequence - 1U) % header.slot_count * header.slot_size;
+}
+
+SlotHeader& slot_header(void* mapping, const std::uint64_t sequence) {
+  return *std::launder(
+      reinterpret_cast<SlotHeader*>(slot_address(mapping, sequence)));
+}
+
+std::byte* slot_data(void* mapping, const std::uint64_t sequence) {
+  return slot_address(mapping, sequence) + align(sizeof(SlotHeader));
+}
+
+}  // namespace
+
+std::string shared_frame_ring_name(const std::string& prefix,
+                                   const std::string& window_name) {
+  std::string name{prefix + "." + window_name};
+  for (char& symbol : name) {
+    if (std::isalnum(static_cast<unsigned char>(symbol)) == 0 and
+        symbol != '.' and symbol != '-' and symbol != '_') {
+      symbol = '_';
+    }
+  }
+  return "/" + name;
+}
+
+SharedFrameRingWriter::SharedFrameRingWriter(std::string segment_name,
+                                             const std::size_t frame_capacity,
+                                             const std::size_t slot_count)
+    : name{std::move(segment_name)} {
+  if (slot_count < 2U) {
+    throw std::runtime_error{"A frame ring needs at least 2 slots"};
+  }
+  const std::size_t slot_size{align(sizeof(SlotHeader)) +
+                              align(frame_capacity)};
+  this->mapping_size = align(sizeof(RingHeader)) + slot_count * slot_size;
+
+  // A crashed run leaves its segment behind
+  ::shm_unlink(this->name.c_str());
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-vararg,hicpp-vararg)
+  const int file{::shm_open(this->name.c_str(),
+                            O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644)};
+  if (file < 0) {
+    throw std::runtime_error{"Cannot create `" + this->name + "`"};
+  }
+  if (::ftruncate(file, static_cast<off_t>(this->mapping_size)) != 0) {
+    ::close(file);
+    ::shm_unlink(this->name.c_str());
+    throw std::runtime_error{"Cannot allocate `" + this->name + "`"};
+  }
+  this->mapping = ::mmap(nullptr, this->mapping_size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED, file, 0);
+  ::close(file);
+  if (this->mapping == MAP_FAILED) {
+    this->mapping = nullptr;
+    ::shm_unlink(this->name.c_str());
+    throw std::runtime_error{"Cannot map `" + this->name + "`"};
+  }
+
+  auto* const header{new (this->mapping) RingHeader{}};
+  header->slot_count = slot_count;
+  header->slot_size = slot_size;
+  header->frame_capacity = frame_capacity;
+  for (std::uint64_t sequence{1U}; sequence <= slot_count; ++sequence) {
+    new (slot_address(this->mapping, sequence)) SlotHeader{};
+  }
+  header->magic.store(magic, std::memory_order_release);
+}
+
+void SharedFrameRingWriter::publish(
+    const cv::Mat& frame,
+    const std::chrono::steady_clock::time_point capture_time) {
+  if (frame.dims != 2 or frame.empty()) {
+    throw std::runtime_error{"Only non-empty 2D frames can be published"};
+  }
+  const std::size_t row_size{static_cast<std::size_t>(frame.cols) *
+                              frame.elemSize()};
+  const std::size_t data_size{row_size * static_cast<std::size_t>(frame.rows)};
+  const RingHeader& header{ring_header(this->mapping)};
+  if (data_size > header.frame_capacity) {
+    throw std::runtime_error{
+        "A frame of " + std::to_string(data_size) + " bytes exceeds the " +
+        std::to_string(header.frame_capacity) + " bytes of `" + this->name +
+        "` slots"};
+  }
+
+  const std::uint64_t sequence{++this->frame_count};
+  SlotHeader& slot{slot_header(this->mapping, sequence)};
+  slot.sequence.store(2U * sequence - 1U, std::memory_order_relaxed);
+  // Readers seeing any of the writes below see the odd sequence too
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.timestamp_ns.store(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          capture_time.time_since_epoch())
+          .count(),
+      std::memory_order_relaxed);
+  slot.rows.store(frame.rows, std::memory_order_relaxed);
+  slot.cols.store(frame.cols, std::memory_order_relaxed);
+  slot.type.store(frame.type(), std::memory_order_relaxed);
+  slot.data_size.store(data_size, std::memory_order_relaxed);
+  std::byte* const data{slot_data(this->mapping, sequence)};
+  if (frame.isContinuous()) {
+    std::memcpy(data, frame.data, data_size);
+  } else {
+    for (int row{0}; row < frame.rows; ++row) {
+      std::memcpy(data + static_cast<std::size_t>(row) * row_size,
+                  frame.ptr(row), row_size);
+    }
+  }
+  slot.sequence.store(2U * sequence, std::memory_order_release);
+  ring_header(this->mapping).latest.store(sequence, std::memory_order_release);
+}
+
+std::uint64_t SharedFrameRingWriter::frames() const noexcept {
+  return this->frame_count;
+}
+
+std::size_t SharedFrameRingWriter::capacity() const noexcept {
+  return ring_header(this->mapping).frame_capacity;
+}
+
+SharedFrameRingWriter::~SharedFrameRingWriter() {
+  // Unlinked first, so a reader that sees the segment closed
+  // and opens the name again cannot get this segment back
+  ::shm_unlink(this->name.c_str());
+  ring_header(this->mapping).is_closed.store(1U, std::memory_order_release);
+  ::munmap(this->mapping, this->mapping_size);
+}
+
+SharedFrameRingReader::SharedFrameRingReader(const std::string& segment_name) {
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-vararg,hicpp-vararg)
+  const int file{::shm_open(segment_name.c_str(), O_RDONLY | O_CLOEXEC, 0)};
+  if (file < 0) {
+    throw std::runtime_error{"Cannot open `" + segment_name + "`"};
+  }
+  struct stat status {};
+  if (::fstat(file, &status) != 0 or
+      static_cast<std::size_t>(status.st_size) < align(sizeof(RingHeader))) {
+    ::close(file);
+    throw std::runtime_error{"`" + segment_name + "` is not a frame ring"};
+  }
+  this->mapping_size = static_cast<std::size_t>(status.st_size);
+  this->mapping =
+      ::mmap(nullptr, this->mapping_size, PROT_READ, MAP_SHARED, file, 0);
+  ::close(file);
+  if (this->mapping == MAP_FAILED) {
+    this->mapping = nullptr;
+    throw std::runtime_error{"Cannot map `" + segment_name + "`"};
+  }
+
+  const RingHeader& header{ring_header(this->mapping)};
+  // Also rejects a segment whose writer has not finished initializing it
+  if (header.magic.load(std::memory_order_acquire) != magic or
+      header.slot_count < 2U or
+      header.slot_size < align(sizeof(SlotHeader)) +
+                             align(header.frame_capacity) or
+      (this->mapping_size - align(sizeof(RingHeader))) / header.slot_size <
+          header.slot_count) {
+    ::munmap(this->mapping, this->mapping_size);
+    throw std::runtime_error{"`" + segment_name + "` is not a frame ring"};
+  }
+}
+
+std::optional<SharedFrameRingReader::View> SharedFrameRingReader::latest(
+    const std::uint64_t after) const {
+  const RingHeader& header{ring_header(this->mapping)};
+  while (true) {
+    const std::uint64_t sequence{
+        header.latest.load(std::memory_order_acquire)};
+    if (sequence <= after) {
+      return std::nullopt;
+    }
+    const SlotHeader& slot{slot_header(this->mapping, sequence)};
+    const std::uint64_t slot_sequence{
+        slot.sequence.load(std::memory_order_acquire)};
+    if (slot_sequence != 2U * sequence) {
+      // Overwritten by a newer frame meanwhile
+      continue;
+    }
+    const std::int64_t timestamp_ns{
+        slot.timestamp_ns.load(std::memory_order_relaxed)};
+    const int rows{slot.rows.load(std::memory_order_relaxed)};
+    const int cols{slot.cols.load(std::memory_order_relaxed)};
+    const int type{slot.type.load(std::memory_order_relaxed)};
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.sequence.load(std::memory_order_relaxed) != slot_sequence) {
+      continue;
+    }
+    return View{
+        .sequence = sequence,
+        .capture_time = std::chrono::steady_clock::time_point{
+            std::chrono::nanoseconds{timestamp_ns}},
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+        .image = {rows, cols, type,
+                  const_cast<std::byte*>(slot_data(this->mapping, sequence))},
+    };
+  }
+}
+
+bool SharedFrameRingReader::is_intact(const View& view) const noexcept {
+  // Orders the reads of the pixels before the sequence check
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return slot_header(this->mapping, view.sequence)
+             .sequence.load(std::memory_order_relaxed) == 2U * view.sequence;
+}
+
+bool SharedFrameRingReader::is_closed() const noexcept {
+  return ring_header(this->mapping).is_closed.load(
+             std::memory_order_acquire) != 0U;
+}
+
+SharedFrameRingReader::~SharedFrameRingReader() {
+  ::munmap(this->mapping, this->mapping_size);
+}
@@ -0,0 +1,100 @@
+// MIT License
+//
+// Copyright (c) 2021-2022 char-lie
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "stage.hpp"
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+#include "frame.hpp"
+
+StageTask::StageTask(const Handle coroutine) noexcept : handle{coroutine} {}
+
+StageTask::StageTask(StageTask&& other) noexcept
+    : handle{std::exchange(other.handle, nullptr)} {}
+
+StageTask& StageTask::operator=(StageTask&& other) noexcept {
+  if (this != &other) {
+    if (this->handle) {
+      this->handle.destroy();
+    }
+    this->handle = std::exchange(other.handle, nullptr);
+  }
+  return *this;
+}
+
+bool StageTask::await_ready() const noexcept { return false; }
+
+std::coroutine_handle<> StageTask::await_suspend(
+    const std::coroutine_handle<> awaiting) const noexcept {
+  this->handle.promise().continuation = awaiting;
+  // Runs on the thread of the awaiting coroutine without growing its stack
+  return this->handle;
+}
+
+std::optional<Frame> StageTask::await_resume() const {
+  promise_type& promise{this->handle.promise()};
+  if (promise.exception) {
+    std::rethrow_exception(promise.exception);
+  }
+  return std::move(promise.output);
+}
+
+StageTask::~StageTask() {
+  if (this->handle) {
+    this->handle.destroy();
+  }
+}
+
+StageTask StageTask::promise_type::get_return_object() noexcept {
+  return StageTask{Handle::from_promise(*this)};
+}
+
+std::suspend_always StageTask::promise_type::initial_suspend() const noexcept {
+  return {};
+}
+
+StageTask::FinalAwaiter StageTask::promise_type::final_suspend()
+    const noexcept {
+  return {};
+}
+
+void StageTask::promise_type::return_value(std::optional<Frame> frame) {
+  this->output = std::move(frame);
+}
+
+void StageTask::promise_type::unhandled_exception() noexcept {
+  this->exception = std::current_exception();
+}
+
+bool StageTask::FinalAwaiter::await_ready() const noexcept { return false; }
+
+std::coroutine_handle<> StageTask::FinalAwaiter::await_suspend(
+    const Handle handle) const noexcept {
+  // The task is destroyed by its owner, after the awaiting coroutine has
+  // taken the result
+  return handle.promise().continuation;
+}
+
+void StageTask::FinalAwaiter::await_resume() const noexcept {}
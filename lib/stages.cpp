@@ -0,0 +1,319 @@
+// MIT License
+//
+// Copyright (c) 2021-2022 char-lie
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "stages.hpp"
+
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <opencv2/core.hpp>
+#include <opencv2/core/mat.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "average_intensity_calculator.hpp"
+#include "display_slot.hpp"
+#include "executor.hpp"
+#include "frame.hpp"
+#include "frame_pool.hpp"
+#include "frame_store.hpp"
+#include "frame_transform.hpp"
+#include "intensity_window.hpp"
+#include "metrics.hpp"
+#include "rate_controller.hpp"
+
+DecimateStage::DecimateStage(const std::size_t decimation_period)
+    : period{decimation_period} {
+  if (this->period == 0U) {
+    throw std::runtime_error{"Decimation period should be positive"};
+  }
+}
+
+std::optional<Frame> DecimateStage::process(Frame frame) {
+  if (++this->frame_number % this->period != 0U) {
+    return std::nullopt;
+  }
+  return frame;
+}
+
+ThrottleStage::ThrottleStage(
+    const std::chrono::steady_clock::duration throttle_period)
+    : period{throttle_period} {}
+
+std::optional<Frame> ThrottleStage::process(Frame frame) {
+  if (this->previous_frame_time and
+      frame.capture_time - *this->previous_frame_time < this->period) {
+    return std::nullopt;
+  }
+  this->previous_frame_time = frame.capture_time;
+  return frame;
+}
+
+StageTask ThrottleStage::process_async(Frame frame, Executor& executor) {
+  std::optional<Frame> output{this->process(std::move(frame))};
+  if (!output) {
+    // Capture times and executor timers share the steady clock
+    co_await executor.sleep_until(*this->previous_frame_time + this->period);
+  }
+  co_return output;
+}
+
+AdaptiveRateStage::AdaptiveRateStage(RateController& rate_controller)
+    : controller{rate_controller} {}
+
+std::optional<Frame> AdaptiveRateStage::process(Frame frame) {
+  if (!this->controller.admit(std::chrono::steady_clock::now())) {
+    return std::nullopt;
+  }
+  return frame;
+}
+
+RateMeteredStage::RateMeteredStage(std::unique_ptr<Stage> metered_stage,
+                                   RateController& rate_controller)
+    : stage{std::move(metered_stage)}, controller{rate_controller} {}
+
+std::optional<Frame> RateMeteredStage::process(Frame frame) {
+  const auto start_time{std::chrono::steady_clock::now()};
+  auto output{this->stage->process(std::move(frame))};
+  this->controller.record(std::chrono::steady_clock::now() - start_time);
+  return output;
+}
+
+ChangeDetectStage::ChangeDetectStage(const double max_difference,
+                                     const bool compressed_frames,
+                                     Counter* unchanged_frames)
+    : threshold{max_difference},
+      is_compressed{compressed_frames},
+      unchanged{unchanged_frames} {}
+
+std::optional<Frame> ChangeDetectStage::process(Frame frame) {
+  if (this->is_compressed) {
+    cv::imdecode(frame.image, cv::IMREAD_REDUCED_GRAYSCALE_8, &this->reduced);
+    if (this->reduced.empty()) {
+      // Left to the decoder, which drops it
+      return frame;
+    }
+    frame_signature(this->reduced, this->signature);
+  } else {
+    frame_signature(frame.image, this->signature);
+  }
+
+  if (this->reference_index != 0U and
+      this->signature.size() == this->reference_signature.size() and
+      this->signature.type() == this->reference_signature.type() and
+      cv::norm(this->signature, this->reference_signature, cv::NORM_INF) <=
+          this->threshold) {
+    frame.content_index = this->reference_index;
+    if (this->unchanged != nullptr) {
+      this->unchanged->add();
+    }
+    return frame;
+  }
+  // The old reference buffer takes the next signature
+  std::swap(this->signature, this->reference_signature);
+  this->reference_index = frame.index;
+  frame.content_index = frame.index;
+  return frame;
+}
+
+ContentReuseStage::ContentReuseStage(std::unique_ptr<Stage> reused_stage,
+                                     const std::uint64_t output_index_period,
+                                     Counter* reused_frames)
+    : stage{std::move(reused_stage)},
+      index_period{output_index_period},
+      reused{reused_frames} {}
+
+std::optional<Frame> ContentReuseStage::process(Frame frame) {
+  const std::uint64_t content_index{frame.content_index};
+  const std::uint64_t period{
+      this->index_period == 0U ? 0U : frame.index / this->index_period};
+  if (content_index != 0U) {
+    const std::lock_guard lock{this->mutex};
+    if (this->output and content_index == this->output_content_index and
+        period == this->output_period) {
+      if (this->reused != nullptr) {
+        this->reused->add();
+      }
+      Frame reused_frame{*this->output};
+      reused_frame.index = frame.index;
+      reused_frame.capture_time = frame.capture_time;
+      return reused_frame;
+    }
+  }
+
+  std::optional<Frame> result{this->stage->process(std::move(frame))};
+  const std::lock_guard lock{this->mutex};
+  this->output = result;
+  this->output_content_index = content_index;
+  this->output_period = period;
+  return result;
+}
+
+GrayRotateStage::GrayRotateStage(FramePool& pool,
+                                 const std::size_t frames_per_rotation,
+                                 const int frame_bands)
+    : frame_pool{pool},
+      rotation_period{frames_per_rotation},
+      bands{frame_bands} {
+  if (this->rotation_period == 0U) {
+    throw std::runtime_error{"Rotation period should be positive"};
+  }
+}
+
+std::optional<Frame> GrayRotateStage::process(Frame frame) {
+  static constexpr std::size_t phases{4U};
+  std::optional<cv::RotateFlags> rotation{};
+  switch (frame.index / this->rotation_period % phases) {
+    case 0:
+      break;
+    case 1:
+      rotation = cv::ROTATE_90_CLOCKWISE;
+      break;
+    case 2:
+      rotation = cv::ROTATE_180;
+      break;
+    case 3:
+      rotation = cv::ROTATE_90_COUNTERCLOCKWISE;
+      break;
+    default:
+      // False positive for `assert`
+      // NOLINTNEXTLINE(misc-static-assert,hicpp-static-assert,cert-dcl03-c,hicpp-no-array-decay,cppcoreguidelines-pro-bounds-array-to-pointer-decay)
+      assert("Check your `switch`. Something is wrong");
+  }
+
+  cv::Mat result;
+  result.allocator = &this->frame_pool;
+  gray_rotate(frame.image, result, rotation, this->bands);
+  frame.image = std::move(result);
+  return frame;
+}
+
+IntensityFlipStage::IntensityFlipStage(AverageIntensityCalculator calculator,
+                                       const std::size_t intensity_threshold,
+                                       FramePool& pool,
+                                       const std::size_t window_length,
+                                       Metrics* metrics,
+                                       const std::string& metrics_prefix,
+                                       const int frame_bands)
+    : average_intensity_calculator{std::move(calculator)},
+      threshold{intensity_threshold},
+      frame_pool{pool},
+      bands{frame_bands} {
+  if (window_length > 1U) {
+    this->intensity_window.emplace(window_length);
+  }
+  if (metrics != nullptr) {
+    this->intensity_time = &metrics->histogram(metrics_prefix + "intensity");
+    this->flip_time = &metrics->histogram(metrics_prefix + "flip");
+    this->escalations =
+        &metrics->counter(metrics_prefix + "intensity.escalations");
+  }
+}
+
+std::optional<Frame> IntensityFlipStage::process(Frame frame) {
+  static constexpr float half{0.5F};
+  const float limit{static_cast<float>(this->threshold) * half};
+  const auto start_time{std::chrono::steady_clock::now()};
+  bool is_bright{false};
+  if (this->intensity_window) {
+    this->intensity_window->add(frame.image);
+    is_bright = this->intensity_window->statistics().mean > limit;
+  } else {
+    const std::size_t escalations_before{
+        this->average_intensity_calculator.escalations()};
+    this->average_intensity_calculator.replace_image(frame.image);
+    is_bright = this->average_intensity_calculator.exceeds(limit);
+    if (this->escalations != nullptr) {
+      this->escalations->add(this->average_intensity_calculator.escalations() -
+                             escalations_before);
+    }
+  }
+  const auto intensity_end_time{std::chrono::steady_clock::now()};
+  if (this->intensity_time != nullptr) {
+    this->intensity_time->record(intensity_end_time - start_time);
+  }
+
+  if (is_bright) {
+    cv::Mat flipped{
+        this->frame_pool.acquire(frame.image.size(), frame.image.type())};
+    mirror(frame.image, flipped, this->bands);
+    frame.image = std::move(flipped);
+    if (this->flip_time != nullptr) {
+      this->flip_time->record(std::chrono::steady_clock::now() -
+                              intensity_end_time);
+    }
+  }
+  return frame;
+}
+
+DisplayStage::DisplayStage(DisplaySlot& slot) : display_slot{slot} {}
+
+std::optional<Frame> DisplayStage::process(Frame frame) {
+  this->display_slot.publish(std::move(frame));
+  return std::nullopt;
+}
+
+namespace {
+
+int decode_flags(const int scale) {
+  switch (scale) {
+    case 1:
+      return cv::IMREAD_COLOR;
+    case 2:
+      return cv::IMREAD_REDUCED_COLOR_2;
+    case 4:
+      return cv::IMREAD_REDUCED_COLOR_4;
+    case 8:
+      return cv::IMREAD_REDUCED_COLOR_8;
+    default:
+      throw std::runtime_error{"Decode scale should be 1, 2, 4 or 8"};
+  }
+}
+
+}  // namespace
+
+DecodeStage::DecodeStage(FramePool& pool, const int scale)
+    : frame_pool{pool}, flags{decode_flags(scale)} {}
+
+std::optional<Frame> DecodeStage::process(Frame frame) {
+  cv::Mat decoded;
+  decoded.allocator = &this->frame_pool;
+  cv::imdecode(frame.image, this->flags, &decoded);
+  if (decoded.empty()) {
+    return std::nullopt;
+  }
+  frame.image = std::move(decoded);
+  return frame;
+}
+
+RecordStage::RecordStage(const std::string& path) : writer{path} {}
+
+std::optional<Frame> RecordStage::process(Frame frame) {
+  this->writer.append(frame.image, frame.capture_time);
+  return std::nullopt;
+}
@@ -0,0 +1,69 @@
+// MIT License
+//
+// Copyright (c) 2021-2022 char-lie
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "thread_settings.hpp"
+
+#include <cstddef>
+#include <cstring>
+#include <pthread.h>
+#include <sched.h>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace {
+
+void check(const int error, const std::string& action) {
+  if (error != 0) {
+    throw std::runtime_error{"Cannot " + action + ": " +
+                             std::strerror(error)};
+  }
+}
+
+}  // namespace
+
+void apply_thread_settings(std::thread& thread,
+                           const ThreadSettings& settings) {
+  if (!settings.cpus.empty()) {
+    cpu_set_t cpu_set{};
+    CPU_ZERO(&cpu_set);
+    for (const int cpu : settings.cpus) {
+      if (cpu < 0 or cpu >= CPU_SETSIZE) {
+        throw std::runtime_error{"CPU " + std::to_string(cpu) +
+                                 " is out of range"};
+      }
+      CPU_SET(static_cast<std::size_t>(cpu), &cpu_set);
+    }
+    check(pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set),
+                                 &cpu_set),
+          "set the CPU affinity");
+  }
+
+  if (settings.realtime_priority) {
+    sched_param parameters{};
+    parameters.sched_priority = *settings.realtime_priority;
+    check(pthread_setschedparam(thread.native_handle(), SCHED_FIFO,
+                                &parameters),
+          "set the real-time priority " +
+              std::to_string(*settings.realtime_priority));
+  }
+}
@@ -0,0 +1,117 @@
+// MIT License
+//
+// Copyright (c) 2021-2022 char-lie
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "worker_pool.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include "thread_settings.hpp"
+
+WorkerPool::Lane::Lane(WorkerPool& worker_pool) : pool{worker_pool} {}
+
+void WorkerPool::Lane::post(std::function<void()> task) {
+  {
+    std::lock_guard lock{this->pool.mutex};
+    if (this->tasks.empty()) {
+      this->pool.ready_lanes.push_back(this);
+    }
+    this->tasks.push_back(std::move(task));
+  }
+  this->pool.work_available.notify_one();
+}
+
+void WorkerPool::Lane::wait_idle() {
+  std::unique_lock lock{this->pool.mutex};
+  this->pool.lane_idle.wait(lock, [this] {
+    return this->tasks.empty() and this->running_tasks == 0U;
+  });
+}
+
+WorkerPool::Lane::~Lane() { this->wait_idle(); }
+
+WorkerPool::WorkerPool(const std::size_t thread_count,
+                       const ThreadSettings& thread_settings) {
+  if (thread_count == 0U) {
+    throw std::runtime_error{"Worker pool should have at least one thread"};
+  }
+  this->threads.reserve(thread_count);
+  try {
+    for (std::size_t i{0U}; i < thread_count; ++i) {
+      this->threads.emplace_back(&WorkerPool::run, this);
+      apply_thread_settings(this->threads.back(), thread_settings);
+    }
+  } catch (...) {
+    this->finish();
+    throw;
+  }
+}
+
+std::size_t WorkerPool::size() const noexcept { return this->threads.size(); }
+
+void WorkerPool::run() {
+  std::unique_lock lock{this->mutex};
+  while (true) {
+    this->work_available.wait(lock, [this] {
+      return !this->ready_lanes.empty() or this->is_finished;
+    });
+    if (this->ready_lanes.empty()) {
+      return;
+    }
+
+    Lane* const lane{this->ready_lanes.front()};
+    this->ready_lanes.pop_front();
+    std::function<void()> task{std::move(lane->tasks.front())};
+    lane->tasks.pop_front();
+    if (!lane->tasks.empty()) {
+      // Back of the line until the other lanes have had their turn
+      this->ready_lanes.push_back(lane);
+    }
+    ++lane->running_tasks;
+
+    lock.unlock();
+    task();
+    lock.lock();
+
+    --lane->running_tasks;
+    if (lane->tasks.empty() and lane->running_tasks == 0U) {
+      this->lane_idle.notify_all();
+    }
+  }
+}
+
+void WorkerPool::finish() {
+  {
+    std::lock_guard lock{this->mutex};
+    this->is_finished = true;
+  }
+  this->work_available.notify_all();
+  for (auto& thread : this->threads) {
+    thread.join();
+  }
+}
+
+WorkerPool::~WorkerPool() { this->finish(); }